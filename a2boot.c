@@ -0,0 +1,778 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define MAX_LINE 256
+#define QUANTUM_Q1 40
+#define QUANTUM_Q2 80
+#define MIN_SWEEP 1
+#define MAX_SWEEP 200
+#define DEFAULT_REPLICAS 1000
+#define ARENA_BLOCK (1 << 20)
+#define NUM_METRICS 5
+
+typedef struct {
+    int pid;
+    int proc_idx;
+    int seq;
+    int arrival_time;
+    int time_until_first_response;
+    int burst_length;
+    int remaining_time;
+    int start_time;
+    int finish_time;
+    int first_response_time;
+    int first_run;
+    int response_happened;
+    int current_queue;
+} Thread;
+
+#include "trace.h"
+
+typedef struct {
+    int earliest_arrival;
+    int latest_finish;
+    int total_burst;
+    int turnaround_time;
+    int waiting_time;
+    int response_time;
+    int seen;
+} Process;
+
+typedef struct {
+    int *thread_idx;
+    int capacity;
+    int front;
+    int rear;
+    int size;
+} Queue;
+
+typedef enum {
+    POLICY_FCFS,
+    POLICY_RR,
+    POLICY_MLFQ
+} Policy;
+
+// Bump allocator owned by one worker. Everything a replica needs is carved
+// out of it and released at once by arena_reset(), so the hot loop never
+// touches malloc once the arena has grown to the largest replica seen.
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t capacity;
+    size_t used;
+    char data[];
+} ArenaBlock;
+
+typedef struct {
+    ArenaBlock *head;
+    size_t total;
+} Arena;
+
+// Remaining replicas of one worker, as the half-open range [lo, hi). The
+// owner takes from hi, thieves take the upper half from lo.
+typedef struct {
+    int lo;
+    int hi;
+    pthread_mutex_t lock;
+} WorkRange;
+
+typedef struct {
+    // Input trace, grouped by PID
+    Thread *threads;
+    int n;
+    int num_groups;
+    int *group_start;
+    int *group_size;
+    int *group_threads;
+    
+    // Perturbation settings
+    int resample;
+    int jitter_arrival;
+    double jitter_burst;
+    unsigned long long seed;
+    
+    // Sweep
+    Policy policy;
+    int num_points;
+    int *points;
+    
+    // results[(point * replicas + replica) * NUM_METRICS + metric]
+    int replicas;
+    double *results;
+    
+    int num_workers;
+    WorkRange *ranges;
+} Job;
+
+typedef struct {
+    Job *job;
+    int id;
+} Worker;
+
+const char *metric_names[NUM_METRICS] = {
+    "Throughput", "Avg_Waiting_Time", "Avg_Turnaround_Time", "Avg_Response_Time", "P99_Response_Time"
+};
+
+void *arena_alloc(Arena *a, size_t size) {
+    size = (size + 15) & ~(size_t)15;
+    if (a->head == NULL || a->head->used + size > a->head->capacity) {
+        size_t capacity = size > ARENA_BLOCK ? size : ARENA_BLOCK;
+        ArenaBlock *block = malloc(sizeof(ArenaBlock) + capacity);
+        if (!block) {
+            fprintf(stderr, "Out of memory\n");
+            exit(1);
+        }
+        block->next = a->head;
+        block->capacity = capacity;
+        block->used = 0;
+        a->head = block;
+        a->total += capacity;
+    }
+    void *p = a->head->data + a->head->used;
+    a->head->used += size;
+    return p;
+}
+
+// Drop everything; if the last replica spilled into several blocks, replace
+// them with one block big enough for all of it
+void arena_reset(Arena *a) {
+    if (a->head && a->head->next) {
+        size_t total = a->total;
+        while (a->head) {
+            ArenaBlock *next = a->head->next;
+            free(a->head);
+            a->head = next;
+        }
+        a->total = 0;
+        arena_alloc(a, total);
+    }
+    if (a->head) a->head->used = 0;
+}
+
+void arena_free(Arena *a) {
+    while (a->head) {
+        ArenaBlock *next = a->head->next;
+        free(a->head);
+        a->head = next;
+    }
+    a->total = 0;
+}
+
+double random_unit(unsigned long long *state) {
+    return (next_random(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+void init_queue(Queue *q, int capacity, Arena *arena) {
+    q->thread_idx = arena_alloc(arena, capacity * sizeof(int));
+    q->capacity = capacity;
+    q->front = 0;
+    q->rear = -1;
+    q->size = 0;
+}
+
+void enqueue(Queue *q, int idx) {
+    q->rear = (q->rear + 1) % q->capacity;
+    q->thread_idx[q->rear] = idx;
+    q->size++;
+}
+
+int dequeue(Queue *q) {
+    if (q->size == 0) return -1;
+    int idx = q->thread_idx[q->front];
+    q->front = (q->front + 1) % q->capacity;
+    q->size--;
+    return idx;
+}
+
+int is_empty(Queue *q) {
+    return q->size == 0;
+}
+
+int parse_line(char *line, Thread *t) {
+    char *token;
+    int field = 0;
+    
+    token = strtok(line, ",");
+    while (token != NULL && field < 4) {
+        switch(field) {
+            case 0: t->pid = atoi(token); break;
+            case 1: t->arrival_time = atoi(token); break;
+            case 2: t->time_until_first_response = atoi(token); break;
+            case 3: t->burst_length = atoi(token); break;
+        }
+        token = strtok(NULL, ",");
+        field++;
+    }
+    return field == 4;
+}
+
+void simulate_fcfs(Thread threads[], int n, int latency) {
+    int current_time = 0;
+    
+    for (int i = 0; i < n; i++) {
+        if (current_time < threads[i].arrival_time) {
+            current_time = threads[i].arrival_time;
+        }
+        current_time += latency;
+        threads[i].start_time = current_time;
+        threads[i].first_response_time = current_time + threads[i].time_until_first_response;
+        current_time += threads[i].burst_length;
+        threads[i].finish_time = current_time;
+    }
+}
+
+void simulate_rr(Thread threads[], int n, int quantum, Arena *arena) {
+    Queue ready_queue;
+    init_queue(&ready_queue, n, arena);
+    
+    int current_time = 0;
+    int completed = 0;
+    int next_arrival_idx = 0;
+    
+    for (int i = 0; i < n; i++) {
+        threads[i].remaining_time = threads[i].burst_length;
+        threads[i].first_run = 1;
+        threads[i].start_time = -1;
+        threads[i].response_happened = 0;
+        threads[i].first_response_time = -1;
+    }
+    
+    while (next_arrival_idx < n && threads[next_arrival_idx].arrival_time <= current_time) {
+        enqueue(&ready_queue, next_arrival_idx);
+        next_arrival_idx++;
+    }
+    
+    while (completed < n) {
+        if (is_empty(&ready_queue)) {
+            // CPU idle, jump to next arrival
+            if (next_arrival_idx < n) {
+                current_time = threads[next_arrival_idx].arrival_time;
+                while (next_arrival_idx < n && threads[next_arrival_idx].arrival_time <= current_time) {
+                    enqueue(&ready_queue, next_arrival_idx);
+                    next_arrival_idx++;
+                }
+            }
+            continue;
+        }
+        
+        current_time += LATENCY;
+        int idx = dequeue(&ready_queue);
+        
+        if (threads[idx].first_run) {
+            threads[idx].start_time = current_time;
+            threads[idx].first_run = 0;
+        }
+        
+        int exec_time = (threads[idx].remaining_time < quantum) ?
+                        threads[idx].remaining_time : quantum;
+        
+        if (!threads[idx].response_happened &&
+            threads[idx].time_until_first_response < exec_time) {
+            threads[idx].first_response_time = current_time + threads[idx].time_until_first_response;
+            threads[idx].response_happened = 1;
+        }
+        
+        threads[idx].remaining_time -= exec_time;
+        current_time += exec_time;
+        
+        while (next_arrival_idx < n && threads[next_arrival_idx].arrival_time <= current_time) {
+            enqueue(&ready_queue, next_arrival_idx);
+            next_arrival_idx++;
+        }
+        
+        if (threads[idx].remaining_time == 0) {
+            threads[idx].finish_time = current_time;
+            if (!threads[idx].response_happened) {
+                threads[idx].first_response_time = current_time;
+            }
+            completed++;
+        } else {
+            enqueue(&ready_queue, idx);
+        }
+    }
+}
+
+void simulate_mlfq(Thread threads[], int n, Arena *arena) {
+    Queue q1, q2, q3;
+    init_queue(&q1, n, arena);
+    init_queue(&q2, n, arena);
+    init_queue(&q3, n, arena);
+    
+    int current_time = 0;
+    int completed = 0;
+    int next_arrival_idx = 0;
+    
+    for (int i = 0; i < n; i++) {
+        threads[i].remaining_time = threads[i].burst_length;
+        threads[i].first_run = 1;
+        threads[i].start_time = -1;
+        threads[i].current_queue = 0;
+        threads[i].response_happened = 0;
+        threads[i].first_response_time = -1;
+    }
+    
+    while (next_arrival_idx < n && threads[next_arrival_idx].arrival_time <= current_time) {
+        enqueue(&q1, next_arrival_idx);
+        next_arrival_idx++;
+    }
+    
+    while (completed < n) {
+        int idx = -1;
+        int quantum = 0;
+        
+        // Priority: Q1 > Q2 > Q3
+        if (!is_empty(&q1)) {
+            idx = dequeue(&q1);
+            quantum = QUANTUM_Q1;
+        } else if (!is_empty(&q2)) {
+            idx = dequeue(&q2);
+            quantum = QUANTUM_Q2;
+        } else if (!is_empty(&q3)) {
+            idx = dequeue(&q3);
+            quantum = threads[idx].remaining_time;
+        } else {
+            // CPU idle, jump to next arrival
+            if (next_arrival_idx < n) {
+                current_time = threads[next_arrival_idx].arrival_time;
+                while (next_arrival_idx < n && threads[next_arrival_idx].arrival_time <= current_time) {
+                    enqueue(&q1, next_arrival_idx);
+                    next_arrival_idx++;
+                }
+            }
+            continue;
+        }
+        
+        current_time += LATENCY;
+        
+        if (threads[idx].first_run) {
+            threads[idx].start_time = current_time;
+            threads[idx].first_run = 0;
+        }
+        
+        int exec_time = (threads[idx].remaining_time < quantum) ?
+                        threads[idx].remaining_time : quantum;
+        
+        if (!threads[idx].response_happened &&
+            threads[idx].time_until_first_response < exec_time) {
+            threads[idx].first_response_time = current_time + threads[idx].time_until_first_response;
+            threads[idx].response_happened = 1;
+        }
+        
+        threads[idx].remaining_time -= exec_time;
+        current_time += exec_time;
+        
+        while (next_arrival_idx < n && threads[next_arrival_idx].arrival_time <= current_time) {
+            enqueue(&q1, next_arrival_idx);
+            next_arrival_idx++;
+        }
+        
+        if (threads[idx].remaining_time == 0) {
+            threads[idx].finish_time = current_time;
+            if (!threads[idx].response_happened) {
+                threads[idx].first_response_time = current_time;
+            }
+            completed++;
+        } else if (threads[idx].current_queue == 0) {
+            threads[idx].current_queue = 1;
+            enqueue(&q2, idx);
+        } else {
+            threads[idx].current_queue = 2;
+            enqueue(&q3, idx);
+        }
+    }
+}
+
+int compare_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Arrival order, ties kept in input order (then by drawn group, for a
+// thread whose PID was drawn more than once)
+int compare_arrival(const void *a, const void *b) {
+    const Thread *x = a, *y = b;
+    if (x->arrival_time != y->arrival_time) return (x->arrival_time > y->arrival_time) ? 1 : -1;
+    if (x->seq != y->seq) return (x->seq > y->seq) ? 1 : -1;
+    return (x->proc_idx > y->proc_idx) - (x->proc_idx < y->proc_idx);
+}
+
+// Same per-PID rules as aggregate_by_pid() in a2p1-a2p3, writing the five
+// summary metrics into out[]
+void aggregate_metrics(Thread threads[], int n, int num_processes, double out[], Arena *arena) {
+    Process *processes = arena_alloc(arena, num_processes * sizeof(Process));
+    int *responses = arena_alloc(arena, num_processes * sizeof(int));
+    
+    memset(processes, 0, num_processes * sizeof(Process));
+    
+    for (int i = 0; i < n; i++) {
+        Process *p = &processes[threads[i].proc_idx];
+        if (!p->seen) {
+            p->seen = 1;
+            p->earliest_arrival = threads[i].arrival_time;
+            p->latest_finish = threads[i].finish_time;
+            p->total_burst = threads[i].burst_length;
+            p->response_time = threads[i].first_response_time - threads[i].arrival_time;
+        } else {
+            if (threads[i].arrival_time < p->earliest_arrival) {
+                p->earliest_arrival = threads[i].arrival_time;
+            }
+            if (threads[i].finish_time > p->latest_finish) {
+                p->latest_finish = threads[i].finish_time;
+            }
+            p->total_burst += threads[i].burst_length;
+            int thread_response = threads[i].first_response_time - p->earliest_arrival;
+            if (thread_response < p->response_time) {
+                p->response_time = thread_response;
+            }
+        }
+    }
+    
+    double total_waiting = 0, total_turnaround = 0, total_response = 0;
+    int max_finish_time = 0;
+    
+    for (int i = 0; i < num_processes; i++) {
+        processes[i].turnaround_time = processes[i].latest_finish - processes[i].earliest_arrival;
+        processes[i].waiting_time = processes[i].turnaround_time - processes[i].total_burst;
+        total_waiting += processes[i].waiting_time;
+        total_turnaround += processes[i].turnaround_time;
+        total_response += processes[i].response_time;
+        responses[i] = processes[i].response_time;
+        if (processes[i].latest_finish > max_finish_time) {
+            max_finish_time = processes[i].latest_finish;
+        }
+    }
+    
+    qsort(responses, num_processes, sizeof(int), compare_int);
+    double exact = 0.99 * num_processes;
+    int rank = (int)exact;
+    if (rank < exact) rank++;
+    if (rank < 1) rank = 1;
+    
+    out[0] = (double)num_processes / max_finish_time;
+    out[1] = total_waiting / num_processes;
+    out[2] = total_turnaround / num_processes;
+    out[3] = total_response / num_processes;
+    out[4] = responses[rank - 1];
+}
+
+// Build one perturbed copy of the trace: optionally resample whole PIDs with
+// replacement, then jitter each thread's arrival and burst, then restore
+// arrival order. Returns the number of threads.
+int build_replica(Job *job, int replica, Thread **out, Arena *arena) {
+    // Each replica derives its own stream from (seed, replica), so results do
+    // not depend on which worker ran it
+    unsigned long long rng = job->seed * 0x100000001B3ULL + (unsigned long long)replica;
+    int *chosen = arena_alloc(arena, job->num_groups * sizeof(int));
+    int n = 0;
+    
+    for (int g = 0; g < job->num_groups; g++) {
+        chosen[g] = job->resample ? (int)(next_random(&rng) % job->num_groups) : g;
+        n += job->group_size[chosen[g]];
+    }
+    
+    Thread *threads = arena_alloc(arena, n * sizeof(Thread));
+    int k = 0;
+    
+    for (int g = 0; g < job->num_groups; g++) {
+        int src = chosen[g];
+        for (int j = 0; j < job->group_size[src]; j++) {
+            Thread *t = &threads[k];
+            int orig = job->group_threads[job->group_start[src] + j];
+            *t = job->threads[orig];
+            
+            // Each drawn group becomes its own process, even if drawn twice
+            t->proc_idx = g;
+            t->seq = orig;
+            
+            if (job->jitter_arrival > 0) {
+                int span = 2 * job->jitter_arrival + 1;
+                t->arrival_time += (int)(next_random(&rng) % span) - job->jitter_arrival;
+                if (t->arrival_time < 0) t->arrival_time = 0;
+            }
+            if (job->jitter_burst > 0) {
+                double scale = 1.0 + job->jitter_burst * (2.0 * random_unit(&rng) - 1.0);
+                t->burst_length = (int)(t->burst_length * scale + 0.5);
+                t->time_until_first_response = (int)(t->time_until_first_response * scale + 0.5);
+                if (t->burst_length < 1) t->burst_length = 1;
+            }
+            k++;
+        }
+    }
+    
+    qsort(threads, n, sizeof(Thread), compare_arrival);
+    *out = threads;
+    return n;
+}
+
+// Simulate every sweep point on the same replica, so comparisons between
+// points are paired rather than independent
+void run_replica(Job *job, int replica, Arena *arena) {
+    Thread *replica_threads;
+    int n = build_replica(job, replica, &replica_threads, arena);
+    Thread *sim_threads = arena_alloc(arena, n * sizeof(Thread));
+    
+    for (int p = 0; p < job->num_points; p++) {
+        memcpy(sim_threads, replica_threads, n * sizeof(Thread));
+        switch (job->policy) {
+            case POLICY_FCFS: simulate_fcfs(sim_threads, n, job->points[p]); break;
+            case POLICY_RR: simulate_rr(sim_threads, n, job->points[p], arena); break;
+            case POLICY_MLFQ: simulate_mlfq(sim_threads, n, arena); break;
+        }
+        double *out = &job->results[((size_t)p * job->replicas + replica) * NUM_METRICS];
+        aggregate_metrics(sim_threads, n, job->num_groups, out, arena);
+    }
+}
+
+// Take one replica from our own range, or steal half of someone else's
+int next_replica(Job *job, int self) {
+    WorkRange *own = &job->ranges[self];
+    int replica = -1;
+    
+    pthread_mutex_lock(&own->lock);
+    if (own->lo < own->hi) replica = --own->hi;
+    pthread_mutex_unlock(&own->lock);
+    if (replica != -1) return replica;
+    
+    for (int i = 1; i < job->num_workers; i++) {
+        WorkRange *victim = &job->ranges[(self + i) % job->num_workers];
+        int lo = 0, hi = 0;
+        
+        pthread_mutex_lock(&victim->lock);
+        int remaining = victim->hi - victim->lo;
+        if (remaining > 0) {
+            int take = (remaining + 1) / 2;
+            lo = victim->lo;
+            hi = victim->lo + take;
+            victim->lo = hi;
+        }
+        pthread_mutex_unlock(&victim->lock);
+        
+        if (hi > lo) {
+            // Keep one, make the rest stealable from us
+            pthread_mutex_lock(&own->lock);
+            own->lo = lo + 1;
+            own->hi = hi;
+            pthread_mutex_unlock(&own->lock);
+            return lo;
+        }
+    }
+    return -1;
+}
+
+void *worker_main(void *arg) {
+    Worker *w = arg;
+    Arena arena = { NULL, 0 };
+    int replica;
+    
+    while ((replica = next_replica(w->job, w->id)) != -1) {
+        run_replica(w->job, replica, &arena);
+        arena_reset(&arena);
+    }
+    
+    arena_free(&arena);
+    return NULL;
+}
+
+// Group thread indices by PID so replicas can resample whole processes. The
+// groups are the process indices from trace.h's PID table, in first-seen
+// order. Returns 0 if out of memory.
+int group_by_pid(Job *job) {
+    job->num_groups = index_processes(job->threads, job->n);
+    if (job->num_groups < 0) return 0;
+    
+    job->group_size = calloc(job->num_groups, sizeof(int));
+    job->group_start = malloc(job->num_groups * sizeof(int));
+    job->group_threads = malloc(job->n * sizeof(int));
+    int *fill = calloc(job->num_groups, sizeof(int));
+    if (!job->group_size || !job->group_start || !job->group_threads || !fill) {
+        free(fill);
+        return 0;
+    }
+    
+    for (int i = 0; i < job->n; i++) job->group_size[job->threads[i].proc_idx]++;
+    for (int g = 0, start = 0; g < job->num_groups; g++) {
+        job->group_start[g] = start;
+        start += job->group_size[g];
+    }
+    
+    for (int i = 0; i < job->n; i++) {
+        int g = job->threads[i].proc_idx;
+        job->group_threads[job->group_start[g] + fill[g]++] = i;
+    }
+    
+    free(fill);
+    return 1;
+}
+
+void write_results(Job *job, FILE *fp, const char *point_name, double confidence) {
+    double *values = malloc(job->replicas * sizeof(double));
+    int lo_rank = (int)((1.0 - confidence) / 2.0 * job->replicas);
+    int hi_rank = job->replicas - 1 - lo_rank;
+    
+    fprintf(fp, "%s", point_name);
+    for (int m = 0; m < NUM_METRICS; m++) {
+        fprintf(fp, ",%s_Mean,%s_CI_Low,%s_CI_High", metric_names[m], metric_names[m], metric_names[m]);
+    }
+    fprintf(fp, "\n");
+    
+    for (int p = 0; p < job->num_points; p++) {
+        fprintf(fp, "%d", job->points[p]);
+        for (int m = 0; m < NUM_METRICS; m++) {
+            double sum = 0;
+            for (int r = 0; r < job->replicas; r++) {
+                values[r] = job->results[((size_t)p * job->replicas + r) * NUM_METRICS + m];
+                sum += values[r];
+            }
+            qsort(values, job->replicas, sizeof(double), compare_double);
+            fprintf(fp, m == 0 ? ",%.6f,%.6f,%.6f" : ",%.2f,%.2f,%.2f",
+                    sum / job->replicas, values[lo_rank], values[hi_rank]);
+        }
+        fprintf(fp, "\n");
+    }
+    
+    free(values);
+}
+
+void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--policy=fcfs|rr|mlfq] [--replicas=N] [--workers=N] [--seed=N]\n", prog);
+    fprintf(stderr, "          [--resample] [--jitter-arrival=T] [--jitter-burst=F]\n");
+    fprintf(stderr, "          [--confidence=C] [--step=N] < input.csv\n");
+}
+
+int main(int argc, char *argv[]) {
+    Job job;
+    double confidence = 0.95;
+    int step = 1;
+    char line[MAX_LINE];
+    
+    memset(&job, 0, sizeof(job));
+    job.policy = POLICY_RR;
+    job.replicas = DEFAULT_REPLICAS;
+    job.seed = 1;
+    job.num_workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--policy=fcfs") == 0) job.policy = POLICY_FCFS;
+        else if (strcmp(argv[i], "--policy=rr") == 0) job.policy = POLICY_RR;
+        else if (strcmp(argv[i], "--policy=mlfq") == 0) job.policy = POLICY_MLFQ;
+        else if (strncmp(argv[i], "--replicas=", 11) == 0) job.replicas = atoi(argv[i] + 11);
+        else if (strncmp(argv[i], "--workers=", 10) == 0) job.num_workers = atoi(argv[i] + 10);
+        else if (strncmp(argv[i], "--seed=", 7) == 0) job.seed = strtoull(argv[i] + 7, NULL, 10);
+        else if (strcmp(argv[i], "--resample") == 0) job.resample = 1;
+        else if (strncmp(argv[i], "--jitter-arrival=", 17) == 0) job.jitter_arrival = atoi(argv[i] + 17);
+        else if (strncmp(argv[i], "--jitter-burst=", 15) == 0) job.jitter_burst = atof(argv[i] + 15);
+        else if (strncmp(argv[i], "--confidence=", 13) == 0) confidence = atof(argv[i] + 13);
+        else if (strncmp(argv[i], "--step=", 7) == 0) step = atoi(argv[i] + 7);
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (job.replicas < 2 || job.num_workers < 1 || step < 1 || confidence <= 0 || confidence >= 1) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    // Without any perturbation every replica would be identical
+    if (!job.resample && job.jitter_arrival == 0 && job.jitter_burst == 0) {
+        job.resample = 1;
+    }
+    
+    // Read header
+    if (fgets(line, MAX_LINE, stdin) == NULL) {
+        fprintf(stderr, "Error reading header\n");
+        return 1;
+    }
+    
+    // Read all threads
+    int capacity = 1024;
+    job.threads = malloc(capacity * sizeof(Thread));
+    while (fgets(line, MAX_LINE, stdin) != NULL) {
+        if (job.n == capacity) {
+            capacity *= 2;
+            job.threads = realloc(job.threads, capacity * sizeof(Thread));
+        }
+        if (parse_line(line, &job.threads[job.n])) {
+            job.n++;
+        }
+    }
+    
+    if (job.n == 0) {
+        fprintf(stderr, "No threads read\n");
+        return 1;
+    }
+    
+    if (!group_by_pid(&job)) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    printf("Read %d threads in %d processes\n", job.n, job.num_groups);
+    
+    // Sweep points: latency for FCFS, quantum for RR, a single run for MLFQ
+    const char *point_name;
+    const char *out_name;
+    if (job.policy == POLICY_MLFQ) {
+        job.num_points = 1;
+        job.points = malloc(sizeof(int));
+        job.points[0] = QUANTUM_Q1;
+        point_name = "Quantum_Q1";
+        out_name = "mlfq_bootstrap.csv";
+    } else {
+        job.num_points = (MAX_SWEEP - MIN_SWEEP) / step + 1;
+        job.points = malloc(job.num_points * sizeof(int));
+        for (int p = 0; p < job.num_points; p++) job.points[p] = MIN_SWEEP + p * step;
+        point_name = (job.policy == POLICY_FCFS) ? "Scheduler_Latency" : "Quantum_Size";
+        out_name = (job.policy == POLICY_FCFS) ? "fcfs_bootstrap.csv" : "rr_bootstrap.csv";
+    }
+    
+    job.results = malloc((size_t)job.num_points * job.replicas * NUM_METRICS * sizeof(double));
+    if (!job.results) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    
+    // Deal replicas out in contiguous ranges; idle workers steal the rest
+    if (job.num_workers > job.replicas) job.num_workers = job.replicas;
+    job.ranges = malloc(job.num_workers * sizeof(WorkRange));
+    Worker *workers = malloc(job.num_workers * sizeof(Worker));
+    pthread_t *tids = malloc(job.num_workers * sizeof(pthread_t));
+    
+    for (int w = 0; w < job.num_workers; w++) {
+        job.ranges[w].lo = (int)((long)job.replicas * w / job.num_workers);
+        job.ranges[w].hi = (int)((long)job.replicas * (w + 1) / job.num_workers);
+        pthread_mutex_init(&job.ranges[w].lock, NULL);
+        workers[w].job = &job;
+        workers[w].id = w;
+    }
+    
+    for (int w = 0; w < job.num_workers; w++) {
+        if (pthread_create(&tids[w], NULL, worker_main, &workers[w]) != 0) {
+            fprintf(stderr, "Error creating worker thread\n");
+            return 1;
+        }
+    }
+    for (int w = 0; w < job.num_workers; w++) {
+        pthread_join(tids[w], NULL);
+    }
+    
+    FILE *fp = fopen(out_name, "w");
+    if (!fp) {
+        fprintf(stderr, "Error opening output file\n");
+        return 1;
+    }
+    write_results(&job, fp, point_name, confidence);
+    fclose(fp);
+    
+    printf("Simulated %d replicas x %d points on %d workers\n", job.replicas, job.num_points, job.num_workers);
+    printf("%.0f%% confidence intervals saved to %s\n", confidence * 100, out_name);
+    
+    return 0;
+}
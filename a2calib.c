@@ -0,0 +1,302 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sched.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+#define DEFAULT_ITERATIONS 20000
+#define WARMUP_ITERATIONS 1000
+#define DEFAULT_UNIT_NS 1000
+
+typedef enum {
+    METHOD_FUTEX,
+    METHOD_PIPE
+} Method;
+
+typedef enum {
+    PIN_SAME,     // both threads on one CPU: every handoff is a context switch
+    PIN_CROSS,    // threads on two CPUs: every handoff is a cross-CPU wakeup
+    PIN_NONE      // let the kernel place them
+} Pinning;
+
+typedef struct {
+    Method method;
+    Pinning pinning;
+    int iterations;
+    int cpus[2];        // initiator's and responder's CPU when pinned
+    int pin_failed;     // set if either thread could not be pinned
+    cpu_set_t allowed;  // affinity mask at startup, restored after each run
+    int turn;           // futex word: 0 = initiator's turn, 1 = responder's turn
+    int to_responder[2];
+    int to_initiator[2];
+    long long *samples; // one-way handoff cost in ns
+} PingPong;
+
+const char *method_names[] = { "futex", "pipe" };
+const char *pin_names[] = { "same", "cross", "none" };
+
+long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void futex_wait(int *addr, int expected) {
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, NULL, NULL, 0);
+}
+
+void futex_wake(int *addr) {
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+}
+
+// Returns 0 if the kernel refused, e.g. the CPU went offline or left our
+// cpuset since startup
+int pin_to_cpu(int cpu) {
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0) {
+        fprintf(stderr, "Cannot pin to CPU %d: %s\n", cpu, strerror(err));
+        return 0;
+    }
+    return 1;
+}
+
+// Hand the turn over and wait for it to come back
+void handoff(PingPong *pp, int give, int wait_for) {
+    if (pp->method == METHOD_FUTEX) {
+        __atomic_store_n(&pp->turn, give, __ATOMIC_RELEASE);
+        futex_wake(&pp->turn);
+        while (__atomic_load_n(&pp->turn, __ATOMIC_ACQUIRE) != wait_for) {
+            futex_wait(&pp->turn, give);
+        }
+    } else {
+        char c = 0;
+        int *out = (give == 1) ? pp->to_responder : pp->to_initiator;
+        int *in = (give == 1) ? pp->to_initiator : pp->to_responder;
+        if (write(out[1], &c, 1) != 1 || read(in[0], &c, 1) != 1) {
+            perror("pipe");
+            exit(1);
+        }
+    }
+}
+
+void *responder_main(void *arg) {
+    PingPong *pp = arg;
+    int total = pp->iterations + WARMUP_ITERATIONS;
+    
+    if (pp->pinning != PIN_NONE && !pin_to_cpu(pp->cpus[pp->pinning == PIN_CROSS])) pp->pin_failed = 1;
+    
+    // Wait for the first ball, then bounce it back each time
+    if (pp->method == METHOD_FUTEX) {
+        while (__atomic_load_n(&pp->turn, __ATOMIC_ACQUIRE) != 1) futex_wait(&pp->turn, 0);
+    } else {
+        char c;
+        if (read(pp->to_responder[0], &c, 1) != 1) return NULL;
+    }
+    for (int i = 0; i < total - 1; i++) {
+        handoff(pp, 0, 1);
+    }
+    if (pp->method == METHOD_FUTEX) {
+        __atomic_store_n(&pp->turn, 0, __ATOMIC_RELEASE);
+        futex_wake(&pp->turn);
+    } else {
+        char c = 0;
+        if (write(pp->to_initiator[1], &c, 1) != 1) perror("pipe");
+    }
+    return NULL;
+}
+
+// Round trip = two handoffs; each sample is half of one round trip
+int measure(PingPong *pp) {
+    pthread_t responder;
+    int total = pp->iterations + WARMUP_ITERATIONS;
+    
+    pp->turn = 0;
+    pp->pin_failed = 0;
+    if (pp->method == METHOD_PIPE && (pipe(pp->to_responder) < 0 || pipe(pp->to_initiator) < 0)) {
+        perror("pipe");
+        return 0;
+    }
+    
+    // Pin the initiator before starting the responder, so the responder
+    // only ever writes pin_failed while we wait for it in pthread_join
+    if (pp->pinning != PIN_NONE && !pin_to_cpu(pp->cpus[0])) pp->pin_failed = 1;
+    if (pthread_create(&responder, NULL, responder_main, pp) != 0) {
+        fprintf(stderr, "Error creating thread\n");
+        return 0;
+    }
+    
+    for (int i = 0; i < total; i++) {
+        long long start = now_ns();
+        handoff(pp, 1, 0);
+        long long end = now_ns();
+        if (i >= WARMUP_ITERATIONS) {
+            pp->samples[i - WARMUP_ITERATIONS] = (end - start) / 2;
+        }
+    }
+    
+    pthread_join(responder, NULL);
+    
+    // Undo pinning for the next configuration
+    pthread_setaffinity_np(pthread_self(), sizeof(pp->allowed), &pp->allowed);
+    
+    if (pp->method == METHOD_PIPE) {
+        close(pp->to_responder[0]);
+        close(pp->to_responder[1]);
+        close(pp->to_initiator[0]);
+        close(pp->to_initiator[1]);
+    }
+    return 1;
+}
+
+int compare_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+long long percentile(long long sorted[], int count, double pct) {
+    double exact = pct / 100.0 * count;
+    int rank = (int)exact;
+    if (rank < exact) rank++;
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return sorted[rank - 1];
+}
+
+// Histogram of samples in simulator time units, one "Latency,Count" row
+// per non-empty bin; this is the format --latency-dist reads
+int write_distribution(const char *path, long long sorted[], int count, int unit_ns) {
+    FILE *fp = fopen(path, "w");
+    if (!fp) {
+        fprintf(stderr, "Error opening %s\n", path);
+        return 0;
+    }
+    
+    fprintf(fp, "Latency,Count\n");
+    int i = 0;
+    while (i < count) {
+        long long units = (sorted[i] + unit_ns / 2) / unit_ns;
+        int bin_count = 0;
+        while (i < count && (sorted[i] + unit_ns / 2) / unit_ns == units) {
+            bin_count++;
+            i++;
+        }
+        fprintf(fp, "%lld,%d\n", units, bin_count);
+    }
+    
+    fclose(fp);
+    return 1;
+}
+
+void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--iterations=N] [--unit-ns=N] [--method=futex|pipe] [--pin=same|cross|none]\n", prog);
+    fprintf(stderr, "          [--output=latency_dist.csv]\n");
+}
+
+int main(int argc, char *argv[]) {
+    int iterations = DEFAULT_ITERATIONS;
+    int unit_ns = DEFAULT_UNIT_NS;
+    Method out_method = METHOD_FUTEX;
+    Pinning out_pinning = PIN_SAME;
+    const char *output = "latency_dist.csv";
+    
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--iterations=", 13) == 0) iterations = atoi(argv[i] + 13);
+        else if (strncmp(argv[i], "--unit-ns=", 10) == 0) unit_ns = atoi(argv[i] + 10);
+        else if (strcmp(argv[i], "--method=futex") == 0) out_method = METHOD_FUTEX;
+        else if (strcmp(argv[i], "--method=pipe") == 0) out_method = METHOD_PIPE;
+        else if (strcmp(argv[i], "--pin=same") == 0) out_pinning = PIN_SAME;
+        else if (strcmp(argv[i], "--pin=cross") == 0) out_pinning = PIN_CROSS;
+        else if (strcmp(argv[i], "--pin=none") == 0) out_pinning = PIN_NONE;
+        else if (strncmp(argv[i], "--output=", 9) == 0) output = argv[i] + 9;
+        else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (iterations < 1 || unit_ns < 1) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    PingPong pp;
+    memset(&pp, 0, sizeof(pp));
+    pp.iterations = iterations;
+    
+    // Pin to the first CPUs this process may actually run on; under taskset
+    // or a cpuset CPUs 0 and 1 need not be among them
+    if (sched_getaffinity(0, sizeof(pp.allowed), &pp.allowed) != 0) {
+        perror("sched_getaffinity");
+        return 1;
+    }
+    int cpus = 0;
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &pp.allowed)) continue;
+        if (cpus < 2) pp.cpus[cpus] = cpu;
+        cpus++;
+    }
+    if (out_pinning == PIN_CROSS && cpus < 2) {
+        fprintf(stderr, "--pin=cross needs at least 2 usable CPUs, affinity mask allows %d\n", cpus);
+        return 1;
+    }
+    
+    pp.samples = malloc(iterations * sizeof(long long));
+    long long *chosen = malloc(iterations * sizeof(long long));
+    if (!pp.samples || !chosen) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    
+    printf("Measuring %d handoffs per configuration on %d usable CPUs (1 time unit = %d ns)\n",
+           iterations, cpus, unit_ns);
+    if (cpus < 2) printf("Pinning to CPU %d\n\n", pp.cpus[0]);
+    else printf("Pinning to CPUs %d and %d\n\n", pp.cpus[0], pp.cpus[1]);
+    printf("%-6s %-8s %10s %10s %10s %10s %10s %10s\n",
+           "Method", "Pin", "Mean_ns", "P50_ns", "P90_ns", "P99_ns", "Max_ns", "Mean_units");
+    
+    for (int m = METHOD_FUTEX; m <= METHOD_PIPE; m++) {
+        for (int p = PIN_SAME; p <= PIN_NONE; p++) {
+            if (p == PIN_CROSS && cpus < 2) continue;
+            
+            pp.method = m;
+            pp.pinning = p;
+            if (!measure(&pp)) return 1;
+            
+            qsort(pp.samples, iterations, sizeof(long long), compare_ll);
+            double sum = 0;
+            for (int i = 0; i < iterations; i++) sum += pp.samples[i];
+            double mean = sum / iterations;
+            
+            // A row we could not pin measured whatever the kernel chose
+            printf("%-6s %-8s %10.0f %10lld %10lld %10lld %10lld %10.2f\n",
+                   method_names[m], pp.pin_failed ? "unpinned" : pin_names[p], mean,
+                   percentile(pp.samples, iterations, 50), percentile(pp.samples, iterations, 90),
+                   percentile(pp.samples, iterations, 99), pp.samples[iterations - 1],
+                   mean / unit_ns);
+            
+            if ((Method)m == out_method && (Pinning)p == out_pinning) {
+                if (pp.pin_failed) {
+                    fprintf(stderr, "Could not place threads for --pin=%s, not writing %s\n",
+                            pin_names[out_pinning], output);
+                    return 1;
+                }
+                memcpy(chosen, pp.samples, iterations * sizeof(long long));
+            }
+        }
+    }
+    
+    if (!write_distribution(output, chosen, iterations, unit_ns)) return 1;
+    printf("\n%s/%s distribution saved to %s\n", method_names[out_method], pin_names[out_pinning], output);
+    
+    free(pp.samples);
+    free(chosen);
+    return 0;
+}
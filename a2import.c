@@ -0,0 +1,446 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <limits.h>
+
+#define MAX_DUMP_LINE 4096
+#define DEFAULT_UNIT_NS 1000
+#define FLUSH_INTERVAL 4096
+#define MAX_PENDING (1 << 20)
+
+// What we know about one kernel task (TID) while streaming the dump
+typedef enum {
+    TASK_IDLE,      // sleeping, or not seen yet
+    TASK_RUNNABLE,  // woken (or preempted) and waiting for a CPU
+    TASK_RUNNING
+} TaskState;
+
+typedef struct {
+    int tid;        // 0 marks an empty slot; the idle task is never stored
+    int tgid;       // -1 until the dump tells us
+    TaskState state;
+    long long arrival_ns;
+    long long running_since_ns;
+    long long run_ns;
+} Task;
+
+typedef struct {
+    Task *slots;
+    int capacity;
+    int count;
+} TaskTable;
+
+// One finished CPU burst, i.e. one row of the simulator input
+typedef struct {
+    long long arrival_ns;
+    long long seq;
+    int pid;
+    long long burst_ns;
+} Record;
+
+// Finished bursts are held back in a min-heap on arrival until no open burst
+// can still produce an earlier one, then written in arrival order
+typedef struct {
+    Record *items;
+    int size;
+    int capacity;
+} RecordHeap;
+
+typedef struct {
+    TaskTable tasks;
+    RecordHeap pending;
+    long long base_ns;
+    long long last_ns;
+    long long unit_ns;
+    long long next_seq;
+    long long events;
+    long long records;
+    long long forced;
+    FILE *out;
+} Importer;
+
+unsigned int hash_tid(int tid, int capacity) {
+    return ((unsigned int)tid * 2654435761u) & (capacity - 1);
+}
+
+Task *find_task(TaskTable *table, int tid);
+
+void grow_tasks(TaskTable *table) {
+    TaskTable bigger;
+    bigger.capacity = table->capacity ? table->capacity * 2 : 1024;
+    bigger.count = 0;
+    bigger.slots = calloc(bigger.capacity, sizeof(Task));
+    if (!bigger.slots) {
+        fprintf(stderr, "Out of memory\n");
+        exit(1);
+    }
+    
+    for (int i = 0; i < table->capacity; i++) {
+        if (table->slots[i].tid != 0) {
+            *find_task(&bigger, table->slots[i].tid) = table->slots[i];
+        }
+    }
+    
+    free(table->slots);
+    *table = bigger;
+}
+
+// Find a task by TID, creating an idle entry the first time it is seen
+Task *find_task(TaskTable *table, int tid) {
+    if (2 * (table->count + 1) > table->capacity) grow_tasks(table);
+    
+    unsigned int h = hash_tid(tid, table->capacity);
+    while (table->slots[h].tid != 0 && table->slots[h].tid != tid) {
+        h = (h + 1) & (table->capacity - 1);
+    }
+    if (table->slots[h].tid == 0) {
+        table->slots[h].tid = tid;
+        table->slots[h].tgid = -1;
+        table->slots[h].state = TASK_IDLE;
+        table->count++;
+    }
+    return &table->slots[h];
+}
+
+int record_before(const Record *a, const Record *b) {
+    if (a->arrival_ns != b->arrival_ns) return a->arrival_ns < b->arrival_ns;
+    return a->seq < b->seq;
+}
+
+void heap_push(RecordHeap *heap, Record r) {
+    if (heap->size == heap->capacity) {
+        heap->capacity = heap->capacity ? heap->capacity * 2 : 1024;
+        heap->items = realloc(heap->items, heap->capacity * sizeof(Record));
+    }
+    int i = heap->size++;
+    while (i > 0 && record_before(&r, &heap->items[(i - 1) / 2])) {
+        heap->items[i] = heap->items[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    heap->items[i] = r;
+}
+
+Record heap_pop(RecordHeap *heap) {
+    Record top = heap->items[0];
+    Record last = heap->items[--heap->size];
+    int i = 0;
+    
+    while (1) {
+        int child = 2 * i + 1;
+        if (child >= heap->size) break;
+        if (child + 1 < heap->size && record_before(&heap->items[child + 1], &heap->items[child])) child++;
+        if (!record_before(&heap->items[child], &last)) break;
+        heap->items[i] = heap->items[child];
+        i = child;
+    }
+    if (heap->size > 0) heap->items[i] = last;
+    return top;
+}
+
+void write_record(Importer *imp, const Record *r) {
+    long long arrival = (r->arrival_ns - imp->base_ns + imp->unit_ns / 2) / imp->unit_ns;
+    long long burst = (r->burst_ns + imp->unit_ns / 2) / imp->unit_ns;
+    if (burst < 1) burst = 1;
+    
+    // The simulators read times into int. Arrivals are already relative to
+    // the first event, so a dump that still does not fit needs a coarser
+    // unit; writing the row anyway would wrap to a negative arrival.
+    if (arrival + burst > INT_MAX) {
+        long long span_ns = r->arrival_ns + r->burst_ns - imp->base_ns;
+        if (imp->last_ns - imp->base_ns > span_ns) span_ns = imp->last_ns - imp->base_ns;
+        
+        fflush(imp->out);
+        fprintf(stderr, "Error: %llds into the dump, times no longer fit in an int at --unit-ns=%lld "
+                "(%lld bursts written); rerun with --unit-ns=%lld or more\n",
+                (r->arrival_ns - imp->base_ns) / 1000000000LL, imp->unit_ns, imp->records,
+                span_ns / INT_MAX + 1);
+        exit(1);
+    }
+    
+    // The dump has no notion of "first response", so the response is taken
+    // to be the first dispatch of the burst
+    fprintf(imp->out, "%d,%lld,0,%lld\n", r->pid, arrival, burst);
+    imp->records++;
+}
+
+// Emit every held-back burst that no open burst can precede
+void flush_pending(Importer *imp, int final) {
+    long long watermark = imp->last_ns;
+    
+    if (!final) {
+        for (int i = 0; i < imp->tasks.capacity; i++) {
+            Task *t = &imp->tasks.slots[i];
+            if (t->tid != 0 && t->state != TASK_IDLE && t->arrival_ns < watermark) {
+                watermark = t->arrival_ns;
+            }
+        }
+    }
+    
+    while (imp->pending.size > 0 && (final || imp->pending.items[0].arrival_ns <= watermark)) {
+        Record r = heap_pop(&imp->pending);
+        write_record(imp, &r);
+    }
+    
+    // A task that never sleeps can hold everything back; cap memory by
+    // writing the oldest bursts anyway and reporting it at the end
+    while (imp->pending.size > MAX_PENDING) {
+        Record r = heap_pop(&imp->pending);
+        write_record(imp, &r);
+        imp->forced++;
+    }
+}
+
+void finish_burst(Importer *imp, Task *t) {
+    if (t->run_ns > 0) {
+        Record r;
+        r.arrival_ns = t->arrival_ns;
+        r.seq = imp->next_seq++;
+        r.pid = (t->tgid != -1) ? t->tgid : t->tid;
+        r.burst_ns = t->run_ns;
+        heap_push(&imp->pending, r);
+    }
+    t->state = TASK_IDLE;
+}
+
+void on_wakeup(Importer *imp, int tid, long long ts) {
+    if (tid == 0) return;
+    Task *t = find_task(&imp->tasks, tid);
+    if (t->state == TASK_IDLE) {
+        t->state = TASK_RUNNABLE;
+        t->arrival_ns = ts;
+        t->run_ns = 0;
+    }
+}
+
+void on_switch(Importer *imp, int prev_tid, int prev_preempted, int next_tid, long long ts) {
+    if (prev_tid != 0) {
+        Task *t = find_task(&imp->tasks, prev_tid);
+        // A task already running when the dump starts has no known arrival,
+        // so its first partial burst is dropped
+        if (t->state == TASK_RUNNING) {
+            t->run_ns += ts - t->running_since_ns;
+            if (prev_preempted) t->state = TASK_RUNNABLE;
+            else finish_burst(imp, t);
+        }
+    }
+    
+    if (next_tid != 0) {
+        Task *t = find_task(&imp->tasks, next_tid);
+        // Dumps recorded without sched_wakeup: the burst starts at dispatch
+        if (t->state == TASK_IDLE) {
+            t->arrival_ns = ts;
+            t->run_ns = 0;
+        }
+        t->state = TASK_RUNNING;
+        t->running_since_ns = ts;
+    }
+}
+
+// Parse "SECONDS.FRACTION:" into nanoseconds without going through a double
+int parse_timestamp(const char *s, long long *ns) {
+    long long sec = 0, frac = 0;
+    int digits = 0;
+    
+    if (!isdigit((unsigned char)*s)) return 0;
+    while (isdigit((unsigned char)*s)) sec = sec * 10 + (*s++ - '0');
+    if (*s++ != '.') return 0;
+    while (isdigit((unsigned char)*s)) {
+        if (digits < 9) {
+            frac = frac * 10 + (*s - '0');
+            digits++;
+        }
+        s++;
+    }
+    if (*s != ':' || digits == 0) return 0;
+    while (digits++ < 9) frac *= 10;
+    
+    *ns = sec * 1000000000LL + frac;
+    return 1;
+}
+
+// The timestamp is the first "N.N:" token on the line, in both formats
+int find_timestamp(const char *line, const char *end, long long *ns) {
+    for (const char *p = line; p < end; p++) {
+        if ((p == line || isspace((unsigned char)p[-1])) && parse_timestamp(p, ns)) return 1;
+    }
+    return 0;
+}
+
+int field_int(const char *s, const char *key, int *value) {
+    const char *p = strstr(s, key);
+    if (!p) return 0;
+    *value = atoi(p + strlen(key));
+    return 1;
+}
+
+// Old perf format "comm:TID [prio]"; returns the text after "]"
+const char *parse_old_task(const char *s, int *tid) {
+    const char *bracket = strstr(s, " [");
+    if (!bracket) return NULL;
+    const char *colon = bracket;
+    while (colon > s && *colon != ':') colon--;
+    if (*colon != ':') return NULL;
+    *tid = atoi(colon + 1);
+    const char *close = strchr(bracket, ']');
+    return close ? close + 1 : NULL;
+}
+
+// Learn TID -> TGID from the line header: ftrace "comm-TID (TGID) [cpu]"
+// with record-tgid, or perf "comm PID/TID [cpu]"
+void learn_tgid(Importer *imp, const char *line, const char *cpu_field) {
+    const char *open = NULL;
+    for (const char *p = line; p < cpu_field; p++) {
+        if (*p == '(') open = p;
+    }
+    
+    if (open) {
+        const char *q = open;
+        while (q > line && isspace((unsigned char)q[-1])) q--;
+        const char *d = q;
+        while (d > line && isdigit((unsigned char)d[-1])) d--;
+        if (d < q && d > line && d[-1] == '-') {
+            int tid = atoi(d);
+            int tgid = atoi(open + 1);
+            if (tid != 0 && tgid > 0) find_task(&imp->tasks, tid)->tgid = tgid;
+        }
+        return;
+    }
+    
+    const char *q = cpu_field;
+    while (q > line && isspace((unsigned char)q[-1])) q--;
+    const char *token = q;
+    while (token > line && !isspace((unsigned char)token[-1])) token--;
+    const char *slash = memchr(token, '/', q - token);
+    if (slash && isdigit((unsigned char)*token)) {
+        int tgid = atoi(token);
+        int tid = atoi(slash + 1);
+        if (tid != 0 && tgid > 0) find_task(&imp->tasks, tid)->tgid = tgid;
+    }
+}
+
+void process_line(Importer *imp, const char *line) {
+    const char *sw = strstr(line, "sched_switch:");
+    const char *wk = strstr(line, "sched_wakeup");
+    const char *event = sw ? sw : wk;
+    long long ts;
+    
+    if (!event || !find_timestamp(line, event, &ts)) return;
+    
+    if (imp->events == 0) imp->base_ns = ts;
+    if (ts > imp->last_ns) imp->last_ns = ts;
+    imp->events++;
+    
+    const char *cpu_field = strstr(line, " [");
+    if (cpu_field && cpu_field < event) learn_tgid(imp, line, cpu_field);
+    
+    if (sw) {
+        const char *args = sw + strlen("sched_switch:");
+        int prev_tid, next_tid;
+        int preempted;
+        
+        if (field_int(args, "prev_pid=", &prev_tid) && field_int(args, "next_pid=", &next_tid)) {
+            const char *state = strstr(args, "prev_state=");
+            preempted = state && state[strlen("prev_state=")] == 'R';
+        } else {
+            // Old perf: "prev:TID [prio] STATE ==> next:TID [prio]"
+            const char *rest = parse_old_task(args, &prev_tid);
+            const char *arrow = strstr(args, "==>");
+            if (!rest || !arrow || !parse_old_task(arrow, &next_tid)) return;
+            while (isspace((unsigned char)*rest)) rest++;
+            preempted = (*rest == 'R');
+        }
+        on_switch(imp, prev_tid, preempted, next_tid, ts);
+    } else {
+        const char *args = strchr(wk, ':');
+        int tid;
+        if (!args) return;
+        if (!field_int(args, " pid=", &tid) && !parse_old_task(args + 1, &tid)) return;
+        on_wakeup(imp, tid, ts);
+    }
+    
+    if (imp->events % FLUSH_INTERVAL == 0) flush_pending(imp, 0);
+}
+
+void import_dump(Importer *imp, FILE *in) {
+    char line[MAX_DUMP_LINE];
+    
+    while (fgets(line, sizeof(line), in) != NULL) {
+        size_t len = strlen(line);
+        // Drop the tail of overlong lines; the fields we need come first
+        if (len == sizeof(line) - 1 && line[len - 1] != '\n') {
+            int c;
+            while ((c = fgetc(in)) != EOF && c != '\n') {}
+        }
+        process_line(imp, line);
+    }
+    
+    // Close bursts still open at the end of the dump
+    for (int i = 0; i < imp->tasks.capacity; i++) {
+        Task *t = &imp->tasks.slots[i];
+        if (t->tid == 0) continue;
+        if (t->state == TASK_RUNNING) {
+            t->run_ns += imp->last_ns - t->running_since_ns;
+        }
+        if (t->state != TASK_IDLE) finish_burst(imp, t);
+    }
+    flush_pending(imp, 1);
+}
+
+void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--unit-ns=N] [DUMP] > trace.csv\n", prog);
+    fprintf(stderr, "  DUMP is 'perf sched script' or ftrace sched_switch/sched_wakeup text (default stdin)\n");
+}
+
+int main(int argc, char *argv[]) {
+    Importer imp;
+    const char *path = NULL;
+    
+    memset(&imp, 0, sizeof(imp));
+    imp.unit_ns = DEFAULT_UNIT_NS;
+    imp.out = stdout;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--unit-ns=", 10) == 0) {
+            imp.unit_ns = atoll(argv[i] + 10);
+        } else if (argv[i][0] != '-' && path == NULL) {
+            path = argv[i];
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    if (imp.unit_ns < 1) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    FILE *in = stdin;
+    if (path) {
+        in = fopen(path, "r");
+        if (!in) {
+            fprintf(stderr, "Error opening %s\n", path);
+            return 1;
+        }
+    }
+    
+    // Large output buffer: the CSV is usually piped straight into a simulator
+    setvbuf(stdout, NULL, _IOFBF, 1 << 20);
+    fprintf(imp.out, "Pid,Arrival Time,Time until first Response,Burst Length\n");
+    
+    import_dump(&imp, in);
+    if (in != stdin) fclose(in);
+    fflush(imp.out);
+    
+    fprintf(stderr, "Imported %lld bursts from %lld scheduler events (%d tasks)\n",
+            imp.records, imp.events, imp.tasks.count);
+    if (imp.forced > 0) {
+        fprintf(stderr, "Warning: %lld bursts were written before older ones to bound memory; "
+                "output may not be fully sorted by arrival\n", imp.forced);
+    }
+    
+    free(imp.tasks.slots);
+    free(imp.pending.items);
+    return 0;
+}
@@ -2,12 +2,19 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define MAX_THREADS 1000
-#define MAX_PROCESSES 50
+#include "stats.h"
+#include "timeline.h"
+
 #define MAX_LINE 256
+#define SUMMARY_COLUMNS 5
+
+// FCFS runs threads straight from the arrival-ordered array: no ready queue
+// and no demotions to count
+#define SIM_COUNTERS (COUNT_LOOP_ITERATIONS | COUNT_DISPATCHES | COUNT_IDLE_JUMPS)
 
 typedef struct {
     int pid;
+    int proc_idx;
     int arrival_time;
     int time_until_first_response;
     int burst_length;
@@ -16,6 +23,8 @@ typedef struct {
     int first_response_time;
 } Thread;
 
+#include "trace.h"
+
 typedef struct {
     int pid;
     int earliest_arrival;
@@ -28,6 +37,8 @@ typedef struct {
     int has_response;
 } Process;
 
+#include "npy.h"
+
 int parse_line(char *line, Thread *t) {
     char *token;
     int field = 0;
@@ -46,17 +57,23 @@ int parse_line(char *line, Thread *t) {
     return field == 4;
 }
 
-void simulate_fcfs(Thread threads[], int n, int latency) {
+void simulate_fcfs(Thread threads[], int n, int latency, Timeline *timeline) {
     int current_time = 0;
     
+    STAT_START(PHASE_SIMULATE);
     for (int i = 0; i < n; i++) {
+        STAT_INC(loop_iterations);
+        
         // Wait for thread to arrive if CPU idle
         if (current_time < threads[i].arrival_time) {
+            STAT_INC(idle_jumps);
             current_time = threads[i].arrival_time;
         }
         
         // Add dispatcher latency
+        if (timeline) timeline_dispatch(timeline, current_time, latency);
         current_time += latency;
+        STAT_INC(dispatches);
         
         // Start execution
         threads[i].start_time = current_time;
@@ -69,36 +86,29 @@ void simulate_fcfs(Thread threads[], int n, int latency) {
         
         // Finish time
         threads[i].finish_time = current_time;
+        
+        if (timeline) {
+            timeline_thread(timeline, threads[i].pid, i, threads[i].arrival_time, threads[i].burst_length);
+            timeline_run(timeline, "run", threads[i].pid, i, threads[i].start_time, threads[i].burst_length, 0);
+            timeline_mark(timeline, "finish", threads[i].pid, i, current_time);
+        }
     }
+    STAT_STOP(PHASE_SIMULATE);
 }
 
 void aggregate_by_pid(Thread threads[], int n, Process processes[], int *num_processes) {
+    STAT_START(PHASE_AGGREGATE);
     *num_processes = 0;
     
-    // Initialize all processes as not found
-    for (int i = 0; i < MAX_PROCESSES; i++) {
-        processes[i].pid = -1;
-        processes[i].has_response = 0;
-        processes[i].first_start = -1;
-    }
-    
     // Aggregate threads by PID
     for (int i = 0; i < n; i++) {
-        int pid = threads[i].pid;
-        
-        // Find or create process entry
-        int proc_idx = -1;
-        for (int j = 0; j < *num_processes; j++) {
-            if (processes[j].pid == pid) {
-                proc_idx = j;
-                break;
-            }
-        }
+        // Process indices follow first-seen order, so an unseen PID is always
+        // the next index
+        int proc_idx = threads[i].proc_idx;
         
-        if (proc_idx == -1) {
+        if (proc_idx == *num_processes) {
             // New process
-            proc_idx = *num_processes;
-            processes[proc_idx].pid = pid;
+            processes[proc_idx].pid = threads[i].pid;
             processes[proc_idx].earliest_arrival = threads[i].arrival_time;
             processes[proc_idx].latest_finish = threads[i].finish_time;
             processes[proc_idx].first_start = threads[i].start_time;
@@ -133,9 +143,11 @@ void aggregate_by_pid(Thread threads[], int n, Process processes[], int *num_pro
         processes[i].turnaround_time = processes[i].latest_finish - processes[i].earliest_arrival;
         processes[i].waiting_time = processes[i].turnaround_time - processes[i].total_burst;
     }
+    STAT_STOP(PHASE_AGGREGATE);
 }
 
 void write_detail_results(FILE *fp, int latency, Process processes[], int num_processes) {
+    STAT_START(PHASE_WRITE);
     for (int i = 0; i < num_processes; i++) {
         fprintf(fp, "%d,%d,%d,%d,%d,%d,%d,%d\n",
                 latency,
@@ -147,21 +159,61 @@ void write_detail_results(FILE *fp, int latency, Process processes[], int num_pr
                 processes[i].waiting_time,
                 processes[i].response_time);
     }
+    STAT_STOP(PHASE_WRITE);
 }
 
-int main() {
-    Thread threads[MAX_THREADS];
+void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--timeline=FILE --at=LATENCY] [--stats[=json]] < input.csv\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    int capacity = 1024;
+    Thread *threads = malloc(capacity * sizeof(Thread));
     int n = 0;
     char line[MAX_LINE];
+    const char *timeline_path = NULL;
+    int timeline_at = 0;
+    int at_given = 0;
+    Timeline *timeline = NULL;
+    StatsFormat stats_format = STATS_OFF;
+    
+    for (int i = 1; i < argc; i++) {
+        if (parse_stats_format(argv[i], &stats_format)) {
+            // --stats or --stats=json
+        } else if (strncmp(argv[i], "--timeline=", 11) == 0) {
+            timeline_path = argv[i] + 11;
+        } else if (strncmp(argv[i], "--at=", 5) == 0) {
+            timeline_at = atoi(argv[i] + 5);
+            at_given = 1;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    // The timeline records one sweep point
+    if (at_given && !timeline_path) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (timeline_path && (timeline_at < 1 || timeline_at > 200)) {
+        fprintf(stderr, "--timeline needs --at=LATENCY between 1 and 200\n");
+        return 1;
+    }
     
     // Read header
+    STAT_START(PHASE_PARSE);
     if (fgets(line, MAX_LINE, stdin) == NULL) {
         fprintf(stderr, "Error reading header\n");
         return 1;
     }
     
     // Read all threads
-    while (fgets(line, MAX_LINE, stdin) != NULL && n < MAX_THREADS) {
+    while (fgets(line, MAX_LINE, stdin) != NULL) {
+        if (n == capacity) {
+            capacity *= 2;
+            threads = realloc(threads, capacity * sizeof(Thread));
+        }
         if (parse_line(line, &threads[n])) {
             n++;
         }
@@ -174,6 +226,17 @@ int main() {
     
     printf("Read %d threads\n", n);
     
+    // Process indices are assigned in arrival order, so sort first
+    int total_processes = sort_by_arrival(threads, n) ? index_processes(threads, n) : -1;
+    if (total_processes < 0) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    
+    // One process table, sized for this trace and reused by every simulation
+    Process *processes = malloc(total_processes * sizeof(Process));
+    STAT_STOP(PHASE_PARSE);
+    
     // Open output files
     FILE *detail_fp = fopen("fcfs_results_details.csv", "w");
     FILE *summary_fp = fopen("fcfs_results.csv", "w");
@@ -183,28 +246,38 @@ int main() {
         return 1;
     }
     
+    // Columnar copies of both tables for plot_results.py
+    NpyFile *detail_npy = npy_open("fcfs_results_details.npy", "<i4", sizeof(int), 200LL * total_processes, DETAIL_COLUMNS);
+    NpyFile *summary_npy = npy_open("fcfs_results.npy", "<f8", sizeof(double), 200, SUMMARY_COLUMNS);
+    if (!detail_npy || !summary_npy) return 1;
+    
+    // Opened last, so an input or output error never leaves a partial timeline
+    if (timeline_path && !(timeline = timeline_open(timeline_path))) return 1;
+    
     // Write headers
     fprintf(detail_fp, "Scheduler_Latency,Pid,Arrival_Time,Start_Time,Finish_Time,Turnaround_Time,Waiting_Time,Response_Time\n");
     fprintf(summary_fp, "Scheduler_Latency,Throughput,Avg_Waiting_Time,Avg_Turnaround_Time,Avg_Response_Time\n");
     
+    Thread *sim_threads = malloc(n * sizeof(Thread));
+    
     // Run simulations for latency 1 to 200
     for (int latency = 1; latency <= 200; latency++) {
         // Create a copy of threads for this simulation
-        Thread sim_threads[MAX_THREADS];
         memcpy(sim_threads, threads, n * sizeof(Thread));
         
         // Run simulation
-        simulate_fcfs(sim_threads, n, latency);
+        simulate_fcfs(sim_threads, n, latency, (latency == timeline_at) ? timeline : NULL);
         
         // Aggregate by PID
-        Process processes[MAX_PROCESSES];
         int num_processes = 0;
         aggregate_by_pid(sim_threads, n, processes, &num_processes);
         
         // Write detailed results
         write_detail_results(detail_fp, latency, processes, num_processes);
+        write_detail_columns(detail_npy, latency - 1, latency, processes, num_processes);
         
         // Calculate average metrics over PROCESSES (not threads)
+        STAT_START(PHASE_AGGREGATE);
         double total_waiting = 0, total_turnaround = 0, total_response = 0;
         int max_finish_time = 0;
         
@@ -221,10 +294,15 @@ int main() {
         double avg_turnaround = total_turnaround / num_processes;
         double avg_response = total_response / num_processes;
         double throughput = (double)num_processes / max_finish_time;
+        STAT_STOP(PHASE_AGGREGATE);
         
         // Write summary results
+        STAT_START(PHASE_WRITE);
         fprintf(summary_fp, "%d,%.6f,%.2f,%.2f,%.2f\n",
                 latency, throughput, avg_waiting, avg_turnaround, avg_response);
+        double row[SUMMARY_COLUMNS] = { latency, throughput, avg_waiting, avg_turnaround, avg_response };
+        write_summary_row(summary_npy, latency - 1, row);
+        STAT_STOP(PHASE_WRITE);
         
         // Print progress
         if (latency % 50 == 0 || latency == 1) {
@@ -235,9 +313,13 @@ int main() {
     
     fclose(detail_fp);
     fclose(summary_fp);
+    npy_close(detail_npy);
+    npy_close(summary_npy);
+    if (timeline) timeline_close(timeline);
     
     printf("\nSimulation completed! Process table results saved to fcfs_results_details.csv\n");
     printf("Average results saved to fcfs_results.csv\n");
     
+    report_stats(stats_format, SIM_COUNTERS);
     return 0;
 }
\ No newline at end of file
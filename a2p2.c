@@ -2,13 +2,20 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define MAX_THREADS 1000
-#define MAX_PROCESSES 50
+#include "stats.h"
+#include "timeline.h"
+
 #define MAX_LINE 256
-#define LATENCY 20
+#define MIN_QUANTUM 1
+#define MAX_QUANTUM 200
+#define SUMMARY_COLUMNS 5
+
+// Counters the RR loop updates (no demotions in a single queue)
+#define SIM_COUNTERS (COUNT_LOOP_ITERATIONS | COUNT_DISPATCHES | COUNT_ENQUEUES | COUNT_DEQUEUES | COUNT_IDLE_JUMPS)
 
 typedef struct {
     int pid;
+    int proc_idx;
     int arrival_time;
     int time_until_first_response;
     int burst_length;
@@ -20,6 +27,8 @@ typedef struct {
     int response_happened;
 } Thread;
 
+#include "trace.h"
+
 typedef struct {
     int pid;
     int earliest_arrival;
@@ -32,29 +41,70 @@ typedef struct {
     int has_response;
 } Process;
 
+#include "npy.h"
+
 typedef struct {
-    int thread_idx[MAX_THREADS];
+    double throughput;
+    double avg_waiting;
+    double avg_turnaround;
+    double avg_response;
+    double p99_turnaround;
+    double p99_response;
+} Metrics;
+
+// Objectives the optimizer can minimize
+typedef enum {
+    OBJ_AVG_WAIT,
+    OBJ_AVG_TAT,
+    OBJ_AVG_RT,
+    OBJ_P99_TAT,
+    OBJ_P99_RT
+} Objective;
+
+typedef struct {
+    Thread *threads;
+    int n;
+    Objective objective;
+    double throughput_weight;
+    const LatencyDist *dist;
+    Process *processes;
+    double cost[MAX_QUANTUM + 1];
+    int evaluated[MAX_QUANTUM + 1];
+    int evaluations;
+} Optimizer;
+
+typedef struct {
+    int *thread_idx;
+    int capacity;
     int front;
     int rear;
     int size;
 } Queue;
 
-void init_queue(Queue *q) {
+void init_queue(Queue *q, int capacity) {
+    q->thread_idx = malloc(capacity * sizeof(int));
+    q->capacity = capacity;
     q->front = 0;
     q->rear = -1;
     q->size = 0;
 }
 
+void free_queue(Queue *q) {
+    free(q->thread_idx);
+}
+
 void enqueue(Queue *q, int idx) {
-    q->rear = (q->rear + 1) % MAX_THREADS;
+    STAT_INC(enqueues);
+    q->rear = (q->rear + 1) % q->capacity;
     q->thread_idx[q->rear] = idx;
     q->size++;
 }
 
 int dequeue(Queue *q) {
     if (q->size == 0) return -1;
+    STAT_INC(dequeues);
     int idx = q->thread_idx[q->front];
-    q->front = (q->front + 1) % MAX_THREADS;
+    q->front = (q->front + 1) % q->capacity;
     q->size--;
     return idx;
 }
@@ -81,13 +131,15 @@ int parse_line(char *line, Thread *t) {
     return field == 4;
 }
 
-void simulate_rr(Thread threads[], int n, int quantum) {
+void simulate_rr(Thread threads[], int n, int quantum, const LatencyDist *dist, Timeline *timeline) {
+    STAT_START(PHASE_SIMULATE);
     Queue ready_queue;
-    init_queue(&ready_queue);
+    init_queue(&ready_queue, n);
     
     int current_time = 0;
     int completed = 0;
     int next_arrival_idx = 0;
+    unsigned long long rng = dist ? dist->seed : 0;
     
     // Initialize threads
     for (int i = 0; i < n; i++) {
@@ -105,8 +157,10 @@ void simulate_rr(Thread threads[], int n, int quantum) {
     }
     
     while (completed < n) {
+        STAT_INC(loop_iterations);
         if (is_empty(&ready_queue)) {
             // CPU idle, jump to next arrival
+            STAT_INC(idle_jumps);
             if (next_arrival_idx < n) {
                 current_time = threads[next_arrival_idx].arrival_time;
                 while (next_arrival_idx < n && threads[next_arrival_idx].arrival_time <= current_time) {
@@ -118,7 +172,10 @@ void simulate_rr(Thread threads[], int n, int quantum) {
         }
         
         // Add dispatcher latency
-        current_time += LATENCY;
+        int latency = dispatch_latency(dist, &rng);
+        if (timeline) timeline_dispatch(timeline, current_time, latency);
+        current_time += latency;
+        STAT_INC(dispatches);
         
         // Get next thread from queue
         int idx = dequeue(&ready_queue);
@@ -127,6 +184,7 @@ void simulate_rr(Thread threads[], int n, int quantum) {
         if (threads[idx].first_run) {
             threads[idx].start_time = current_time;
             threads[idx].first_run = 0;
+            if (timeline) timeline_thread(timeline, threads[idx].pid, idx, threads[idx].arrival_time, threads[idx].burst_length);
         }
         
         // Execute for quantum or remaining time, whichever is smaller
@@ -141,6 +199,9 @@ void simulate_rr(Thread threads[], int n, int quantum) {
         }
         
         threads[idx].remaining_time -= exec_time;
+        if (timeline) {
+            timeline_run(timeline, "run", threads[idx].pid, idx, current_time, exec_time, threads[idx].remaining_time);
+        }
         current_time += exec_time;
         
         // Check for new arrivals during execution
@@ -157,40 +218,31 @@ void simulate_rr(Thread threads[], int n, int quantum) {
                 threads[idx].first_response_time = current_time;
             }
             completed++;
+            if (timeline) timeline_mark(timeline, "finish", threads[idx].pid, idx, current_time);
         } else {
             // Thread not finished, add back to queue
             enqueue(&ready_queue, idx);
+            if (timeline) timeline_mark(timeline, "preempt", threads[idx].pid, idx, current_time);
         }
     }
+    
+    STAT_STOP(PHASE_SIMULATE);
+    free_queue(&ready_queue);
 }
 
 void aggregate_by_pid(Thread threads[], int n, Process processes[], int *num_processes) {
+    STAT_START(PHASE_AGGREGATE);
     *num_processes = 0;
     
-    // Initialize all processes as not found
-    for (int i = 0; i < MAX_PROCESSES; i++) {
-        processes[i].pid = -1;
-        processes[i].has_response = 0;
-        processes[i].first_start = -1;
-    }
-    
     // Aggregate threads by PID
     for (int i = 0; i < n; i++) {
-        int pid = threads[i].pid;
-        
-        // Find or create process entry
-        int proc_idx = -1;
-        for (int j = 0; j < *num_processes; j++) {
-            if (processes[j].pid == pid) {
-                proc_idx = j;
-                break;
-            }
-        }
+        // Process indices follow first-seen order, so an unseen PID is always
+        // the next index
+        int proc_idx = threads[i].proc_idx;
         
-        if (proc_idx == -1) {
+        if (proc_idx == *num_processes) {
             // New process
-            proc_idx = *num_processes;
-            processes[proc_idx].pid = pid;
+            processes[proc_idx].pid = threads[i].pid;
             processes[proc_idx].earliest_arrival = threads[i].arrival_time;
             processes[proc_idx].latest_finish = threads[i].finish_time;
             processes[proc_idx].first_start = threads[i].start_time;
@@ -225,9 +277,11 @@ void aggregate_by_pid(Thread threads[], int n, Process processes[], int *num_pro
         processes[i].turnaround_time = processes[i].latest_finish - processes[i].earliest_arrival;
         processes[i].waiting_time = processes[i].turnaround_time - processes[i].total_burst;
     }
+    STAT_STOP(PHASE_AGGREGATE);
 }
 
 void write_detail_results(FILE *fp, int quantum, Process processes[], int num_processes) {
+    STAT_START(PHASE_WRITE);
     for (int i = 0; i < num_processes; i++) {
         fprintf(fp, "%d,%d,%d,%d,%d,%d,%d,%d\n",
                 quantum,
@@ -239,21 +293,230 @@ void write_detail_results(FILE *fp, int quantum, Process processes[], int num_pr
                 processes[i].waiting_time,
                 processes[i].response_time);
     }
+    STAT_STOP(PHASE_WRITE);
+}
+
+int compare_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of an unsorted array (sorts it in place)
+double percentile(int values[], int count, double pct) {
+    qsort(values, count, sizeof(int), compare_int);
+    double exact = pct / 100.0 * count;
+    int rank = (int)exact;
+    if (rank < exact) rank++;
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return values[rank - 1];
+}
+
+void compute_metrics(Process processes[], int num_processes, Metrics *m) {
+    double total_waiting = 0, total_turnaround = 0, total_response = 0;
+    int max_finish_time = 0;
+    int *turnarounds = malloc(num_processes * sizeof(int));
+    int *responses = malloc(num_processes * sizeof(int));
+    
+    STAT_START(PHASE_AGGREGATE);
+    for (int i = 0; i < num_processes; i++) {
+        total_waiting += processes[i].waiting_time;
+        total_turnaround += processes[i].turnaround_time;
+        total_response += processes[i].response_time;
+        turnarounds[i] = processes[i].turnaround_time;
+        responses[i] = processes[i].response_time;
+        if (processes[i].latest_finish > max_finish_time) {
+            max_finish_time = processes[i].latest_finish;
+        }
+    }
+    
+    m->avg_waiting = total_waiting / num_processes;
+    m->avg_turnaround = total_turnaround / num_processes;
+    m->avg_response = total_response / num_processes;
+    m->throughput = (double)num_processes / max_finish_time;
+    m->p99_turnaround = percentile(turnarounds, num_processes, 99.0);
+    m->p99_response = percentile(responses, num_processes, 99.0);
+    
+    free(turnarounds);
+    free(responses);
+    STAT_STOP(PHASE_AGGREGATE);
+}
+
+int parse_objective(const char *name, Objective *obj) {
+    if (strcmp(name, "avg_wait") == 0) *obj = OBJ_AVG_WAIT;
+    else if (strcmp(name, "avg_tat") == 0) *obj = OBJ_AVG_TAT;
+    else if (strcmp(name, "avg_rt") == 0) *obj = OBJ_AVG_RT;
+    else if (strcmp(name, "p99_tat") == 0) *obj = OBJ_P99_TAT;
+    else if (strcmp(name, "p99_rt") == 0) *obj = OBJ_P99_RT;
+    else return 0;
+    return 1;
+}
+
+// Lower is better. Throughput is scaled per 10000 time units (same as the
+// plots) so a weight of 1 trades one time unit of latency for 0.0001 throughput
+double objective_cost(const Metrics *m, Objective obj, double throughput_weight) {
+    double value = 0;
+    switch (obj) {
+        case OBJ_AVG_WAIT: value = m->avg_waiting; break;
+        case OBJ_AVG_TAT: value = m->avg_turnaround; break;
+        case OBJ_AVG_RT: value = m->avg_response; break;
+        case OBJ_P99_TAT: value = m->p99_turnaround; break;
+        case OBJ_P99_RT: value = m->p99_response; break;
+    }
+    return value - throughput_weight * m->throughput * 10000;
+}
+
+void run_rr(Thread threads[], int n, int quantum, const LatencyDist *dist, Timeline *timeline,
+            Process processes[], int *num_processes) {
+    Thread *sim_threads = malloc(n * sizeof(Thread));
+    memcpy(sim_threads, threads, n * sizeof(Thread));
+    simulate_rr(sim_threads, n, quantum, dist, timeline);
+    aggregate_by_pid(sim_threads, n, processes, num_processes);
+    free(sim_threads);
+}
+
+// Cost of a quantum, simulating it only the first time it is asked for
+double evaluate_quantum(Optimizer *opt, int quantum) {
+    if (!opt->evaluated[quantum]) {
+        Process *processes = opt->processes;
+        int num_processes = 0;
+        Metrics m;
+        run_rr(opt->threads, opt->n, quantum, opt->dist, NULL, processes, &num_processes);
+        compute_metrics(processes, num_processes, &m);
+        opt->cost[quantum] = objective_cost(&m, opt->objective, opt->throughput_weight);
+        opt->evaluated[quantum] = 1;
+        opt->evaluations++;
+    }
+    return opt->cost[quantum];
+}
+
+// Coarse-to-fine search: scan the range on a coarse grid, then shrink the
+// window around the best point and refine the step until it reaches 1.
+// Ties keep the smaller quantum.
+int optimize_quantum(Optimizer *opt) {
+    int lo = MIN_QUANTUM, hi = MAX_QUANTUM;
+    int step = (hi - lo) / 8;
+    int best = lo;
+    
+    if (step < 1) step = 1;
+    
+    while (1) {
+        for (int q = lo; q <= hi; q += step) {
+            if (evaluate_quantum(opt, q) < evaluate_quantum(opt, best)) best = q;
+        }
+        if (evaluate_quantum(opt, hi) < evaluate_quantum(opt, best)) best = hi;
+        
+        if (step == 1) break;
+        
+        lo = (best - step > MIN_QUANTUM) ? best - step : MIN_QUANTUM;
+        hi = (best + step < MAX_QUANTUM) ? best + step : MAX_QUANTUM;
+        step = (step / 4 > 1) ? step / 4 : 1;
+    }
+    return best;
 }
 
-int main() {
-    Thread threads[MAX_THREADS];
+int run_optimizer(Thread threads[], int n, Objective objective, double throughput_weight,
+                  const LatencyDist *dist, Timeline *timeline, Process processes[]) {
+    Optimizer opt;
+    memset(&opt, 0, sizeof(opt));
+    opt.threads = threads;
+    opt.n = n;
+    opt.objective = objective;
+    opt.throughput_weight = throughput_weight;
+    opt.dist = dist;
+    opt.processes = processes;
+    
+    int best = optimize_quantum(&opt);
+    
+    int num_processes = 0;
+    Metrics m;
+    run_rr(threads, n, best, dist, timeline, processes, &num_processes);
+    compute_metrics(processes, num_processes, &m);
+    if (timeline) timeline_close(timeline);
+    
+    printf("Evaluated %d of %d quantum sizes\n", opt.evaluations, MAX_QUANTUM - MIN_QUANTUM + 1);
+    printf("\nQuantum_Size,Throughput,Avg_Waiting_Time,Avg_Turnaround_Time,Avg_Response_Time,P99_Turnaround_Time,P99_Response_Time,Cost\n");
+    printf("%d,%.6f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+           best, m.throughput, m.avg_waiting, m.avg_turnaround, m.avg_response,
+           m.p99_turnaround, m.p99_response, opt.cost[best]);
+    return 0;
+}
+
+void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--optimize=METRIC] [--throughput-weight=W]\n", prog);
+    fprintf(stderr, "          [--latency-dist=FILE] [--seed=N] [--timeline=FILE [--at=QUANTUM]] [--stats[=json]] < input.csv\n");
+    fprintf(stderr, "  METRIC is one of avg_wait, avg_tat, avg_rt, p99_tat, p99_rt\n");
+    fprintf(stderr, "  --at picks the swept quantum to record; with --optimize the timeline records the best one\n");
+}
+
+int main(int argc, char *argv[]) {
+    int capacity = 1024;
+    Thread *threads = malloc(capacity * sizeof(Thread));
     int n = 0;
     char line[MAX_LINE];
+    int optimize = 0;
+    Objective objective = OBJ_AVG_RT;
+    double throughput_weight = 0;
+    LatencyDist latency_dist;
+    const LatencyDist *dist = NULL;
+    const char *timeline_path = NULL;
+    StatsFormat stats_format = STATS_OFF;
+    int timeline_at = 0;
+    int at_given = 0;
+    Timeline *timeline = NULL;
+    
+    latency_dist.seed = 1;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--optimize=", 11) == 0) {
+            if (!parse_objective(argv[i] + 11, &objective)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            optimize = 1;
+        } else if (strncmp(argv[i], "--throughput-weight=", 20) == 0) {
+            throughput_weight = atof(argv[i] + 20);
+        } else if (strncmp(argv[i], "--latency-dist=", 15) == 0) {
+            if (!load_latency_dist(argv[i] + 15, &latency_dist)) return 1;
+            dist = &latency_dist;
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            latency_dist.seed = strtoull(argv[i] + 7, NULL, 10);
+        } else if (parse_stats_format(argv[i], &stats_format)) {
+            // --stats or --stats=json
+        } else if (strncmp(argv[i], "--timeline=", 11) == 0) {
+            timeline_path = argv[i] + 11;
+        } else if (strncmp(argv[i], "--at=", 5) == 0) {
+            timeline_at = atoi(argv[i] + 5);
+            at_given = 1;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    // The timeline records one sweep point, or the optimizer's best quantum
+    if (at_given && (!timeline_path || optimize)) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    if (timeline_path && !optimize && (timeline_at < MIN_QUANTUM || timeline_at > MAX_QUANTUM)) {
+        fprintf(stderr, "--timeline needs --at=QUANTUM between %d and %d\n", MIN_QUANTUM, MAX_QUANTUM);
+        return 1;
+    }
     
     // Read header
+    STAT_START(PHASE_PARSE);
     if (fgets(line, MAX_LINE, stdin) == NULL) {
         fprintf(stderr, "Error reading header\n");
         return 1;
     }
     
     // Read all threads
-    while (fgets(line, MAX_LINE, stdin) != NULL && n < MAX_THREADS) {
+    while (fgets(line, MAX_LINE, stdin) != NULL) {
+        if (n == capacity) {
+            capacity *= 2;
+            threads = realloc(threads, capacity * sizeof(Thread));
+        }
         if (parse_line(line, &threads[n])) {
             n++;
         }
@@ -266,6 +529,27 @@ int main() {
     
     printf("Read %d threads\n", n);
     
+    // Process indices are assigned in arrival order, so sort first
+    int total_processes = sort_by_arrival(threads, n) ? index_processes(threads, n) : -1;
+    if (total_processes < 0) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    
+    // One process table, sized for this trace and reused by every simulation
+    Process *processes = malloc(total_processes * sizeof(Process));
+    STAT_STOP(PHASE_PARSE);
+    if (dist) {
+        printf("Dispatcher latency sampled from %d-bin measured distribution\n", dist->num_bins);
+    }
+    
+    if (optimize) {
+        if (timeline_path && !(timeline = timeline_open(timeline_path))) return 1;
+        int status = run_optimizer(threads, n, objective, throughput_weight, dist, timeline, processes);
+        report_stats(stats_format, SIM_COUNTERS);
+        return status;
+    }
+    
     // Open output files
     FILE *detail_fp = fopen("rr_results_details.csv", "w");
     FILE *summary_fp = fopen("rr_results.csv", "w");
@@ -275,61 +559,58 @@ int main() {
         return 1;
     }
     
+    // Columnar copies of both tables for plot_results.py
+    int sweep_points = MAX_QUANTUM - MIN_QUANTUM + 1;
+    NpyFile *detail_npy = npy_open("rr_results_details.npy", "<i4", sizeof(int),
+                                   (long long)sweep_points * total_processes, DETAIL_COLUMNS);
+    NpyFile *summary_npy = npy_open("rr_results.npy", "<f8", sizeof(double), sweep_points, SUMMARY_COLUMNS);
+    if (!detail_npy || !summary_npy) return 1;
+    
+    // Opened last, so an input or output error never leaves a partial timeline
+    if (timeline_path && !(timeline = timeline_open(timeline_path))) return 1;
+    
     // Write headers
     fprintf(detail_fp, "Quantum_Size,Pid,Arrival_Time,Start_Time,Finish_Time,Turnaround_Time,Waiting_Time,Response_Time\n");
     fprintf(summary_fp, "Quantum_Size,Throughput,Avg_Waiting_Time,Avg_Turnaround_Time,Avg_Response_Time\n");
     
     // Run simulations for quantum 1 to 200
-    for (int quantum = 1; quantum <= 200; quantum++) {
-        // Create a copy of threads for this simulation
-        Thread sim_threads[MAX_THREADS];
-        memcpy(sim_threads, threads, n * sizeof(Thread));
-        
-        // Run simulation
-        simulate_rr(sim_threads, n, quantum);
-        
-        // Aggregate by PID
-        Process processes[MAX_PROCESSES];
+    for (int quantum = MIN_QUANTUM; quantum <= MAX_QUANTUM; quantum++) {
+        // Simulate on a copy of the threads and aggregate by PID
         int num_processes = 0;
-        aggregate_by_pid(sim_threads, n, processes, &num_processes);
+        run_rr(threads, n, quantum, dist, (quantum == timeline_at) ? timeline : NULL, processes, &num_processes);
         
         // Write detailed results
         write_detail_results(detail_fp, quantum, processes, num_processes);
+        write_detail_columns(detail_npy, quantum - MIN_QUANTUM, quantum, processes, num_processes);
         
         // Calculate average metrics over PROCESSES (not threads)
-        double total_waiting = 0, total_turnaround = 0, total_response = 0;
-        int max_finish_time = 0;
-        
-        for (int i = 0; i < num_processes; i++) {
-            total_waiting += processes[i].waiting_time;
-            total_turnaround += processes[i].turnaround_time;
-            total_response += processes[i].response_time;
-            if (processes[i].latest_finish > max_finish_time) {
-                max_finish_time = processes[i].latest_finish;
-            }
-        }
-        
-        double avg_waiting = total_waiting / num_processes;
-        double avg_turnaround = total_turnaround / num_processes;
-        double avg_response = total_response / num_processes;
-        double throughput = (double)num_processes / max_finish_time;
+        Metrics m;
+        compute_metrics(processes, num_processes, &m);
         
         // Write summary results
+        STAT_START(PHASE_WRITE);
         fprintf(summary_fp, "%d,%.6f,%.2f,%.2f,%.2f\n",
-                quantum, throughput, avg_waiting, avg_turnaround, avg_response);
+                quantum, m.throughput, m.avg_waiting, m.avg_turnaround, m.avg_response);
+        double row[SUMMARY_COLUMNS] = { quantum, m.throughput, m.avg_waiting, m.avg_turnaround, m.avg_response };
+        write_summary_row(summary_npy, quantum - MIN_QUANTUM, row);
+        STAT_STOP(PHASE_WRITE);
         
         // Print progress
         if (quantum % 50 == 0 || quantum == 1) {
             printf("Completed quantum %d: Throughput=%.6f, Avg_Wait=%.2f, Avg_TAT=%.2f, Avg_RT=%.2f\n",
-                   quantum, throughput, avg_waiting, avg_turnaround, avg_response);
+                   quantum, m.throughput, m.avg_waiting, m.avg_turnaround, m.avg_response);
         }
     }
     
     fclose(detail_fp);
     fclose(summary_fp);
+    npy_close(detail_npy);
+    npy_close(summary_npy);
+    if (timeline) timeline_close(timeline);
     
     printf("\nRR simulation completed! Results saved to rr_results.csv\n");
     printf("Average results saved to rr_results_details.csv\n");
     
+    report_stats(stats_format, SIM_COUNTERS);
     return 0;
 }
\ No newline at end of file
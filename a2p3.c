@@ -2,15 +2,22 @@
 #include <stdlib.h>
 #include <string.h>
 
-#define MAX_THREADS 1000
-#define MAX_PROCESSES 50
+#include "stats.h"
+#include "timeline.h"
+
 #define MAX_LINE 256
-#define LATENCY 20
 #define QUANTUM_Q1 40
 #define QUANTUM_Q2 80
+#define MIN_QUANTUM 1
+#define MAX_QUANTUM 200
+#define SUMMARY_COLUMNS 8
+
+// Counters the MLFQ loop updates
+#define SIM_COUNTERS (COUNT_LOOP_ITERATIONS | COUNT_DISPATCHES | COUNT_ENQUEUES | COUNT_DEQUEUES | COUNT_IDLE_JUMPS | COUNT_DEMOTIONS)
 
 typedef struct {
     int pid;
+    int proc_idx;
     int arrival_time;
     int time_until_first_response;
     int burst_length;
@@ -23,6 +30,8 @@ typedef struct {
     int current_queue;
 } Thread;
 
+#include "trace.h"
+
 typedef struct {
     int pid;
     int earliest_arrival;
@@ -35,29 +44,72 @@ typedef struct {
     int has_response;
 } Process;
 
+#include "npy.h"
+
+typedef struct {
+    double throughput;
+    double avg_waiting;
+    double avg_turnaround;
+    double avg_response;
+    double p99_turnaround;
+    double p99_response;
+} Metrics;
+
+// Objectives the optimizer can minimize
+typedef enum {
+    OBJ_AVG_WAIT,
+    OBJ_AVG_TAT,
+    OBJ_AVG_RT,
+    OBJ_P99_TAT,
+    OBJ_P99_RT
+} Objective;
+
+// Evaluated (Q1, Q2) points are cached so overlapping refinement windows
+// never re-simulate a pair
 typedef struct {
-    int thread_idx[MAX_THREADS];
+    Thread *threads;
+    int n;
+    Objective objective;
+    double throughput_weight;
+    const LatencyDist *dist;
+    Process *processes;
+    double cost[MAX_QUANTUM + 1][MAX_QUANTUM + 1];
+    unsigned char evaluated[MAX_QUANTUM + 1][MAX_QUANTUM + 1];
+    int evaluations;
+} Optimizer;
+
+typedef struct {
+    int *thread_idx;
+    int capacity;
     int front;
     int rear;
     int size;
 } Queue;
 
-void init_queue(Queue *q) {
+void init_queue(Queue *q, int capacity) {
+    q->thread_idx = malloc(capacity * sizeof(int));
+    q->capacity = capacity;
     q->front = 0;
     q->rear = -1;
     q->size = 0;
 }
 
+void free_queue(Queue *q) {
+    free(q->thread_idx);
+}
+
 void enqueue(Queue *q, int idx) {
-    q->rear = (q->rear + 1) % MAX_THREADS;
+    STAT_INC(enqueues);
+    q->rear = (q->rear + 1) % q->capacity;
     q->thread_idx[q->rear] = idx;
     q->size++;
 }
 
 int dequeue(Queue *q) {
     if (q->size == 0) return -1;
+    STAT_INC(dequeues);
     int idx = q->thread_idx[q->front];
-    q->front = (q->front + 1) % MAX_THREADS;
+    q->front = (q->front + 1) % q->capacity;
     q->size--;
     return idx;
 }
@@ -84,15 +136,20 @@ int parse_line(char *line, Thread *t) {
     return field == 4;
 }
 
-void simulate_mlfq(Thread threads[], int n) {
+const char *level_names[] = { "Q1", "Q2", "Q3" };
+
+void simulate_mlfq(Thread threads[], int n, int quantum_q1, int quantum_q2, const LatencyDist *dist,
+                   Timeline *timeline) {
+    STAT_START(PHASE_SIMULATE);
     Queue q1, q2, q3;
-    init_queue(&q1);
-    init_queue(&q2);
-    init_queue(&q3);
+    init_queue(&q1, n);
+    init_queue(&q2, n);
+    init_queue(&q3, n);
     
     int current_time = 0;
     int completed = 0;
     int next_arrival_idx = 0;
+    unsigned long long rng = dist ? dist->seed : 0;
     
     // Initialize threads
     for (int i = 0; i < n; i++) {
@@ -111,21 +168,23 @@ void simulate_mlfq(Thread threads[], int n) {
     }
     
     while (completed < n) {
+        STAT_INC(loop_iterations);
         int idx = -1;
         int quantum = 0;
         
         // Priority: Q1 > Q2 > Q3
         if (!is_empty(&q1)) {
             idx = dequeue(&q1);
-            quantum = QUANTUM_Q1;
+            quantum = quantum_q1;
         } else if (!is_empty(&q2)) {
             idx = dequeue(&q2);
-            quantum = QUANTUM_Q2;
+            quantum = quantum_q2;
         } else if (!is_empty(&q3)) {
             idx = dequeue(&q3);
             quantum = threads[idx].remaining_time;
         } else {
             // CPU idle, jump to next arrival
+            STAT_INC(idle_jumps);
             if (next_arrival_idx < n) {
                 current_time = threads[next_arrival_idx].arrival_time;
                 while (next_arrival_idx < n && threads[next_arrival_idx].arrival_time <= current_time) {
@@ -137,12 +196,16 @@ void simulate_mlfq(Thread threads[], int n) {
         }
         
         // Add dispatcher latency
-        current_time += LATENCY;
+        int latency = dispatch_latency(dist, &rng);
+        if (timeline) timeline_dispatch(timeline, current_time, latency);
+        current_time += latency;
+        STAT_INC(dispatches);
         
         // Record start time if first run
         if (threads[idx].first_run) {
             threads[idx].start_time = current_time;
             threads[idx].first_run = 0;
+            if (timeline) timeline_thread(timeline, threads[idx].pid, idx, threads[idx].arrival_time, threads[idx].burst_length);
         }
         
         // Execute for quantum or remaining time, whichever is smaller
@@ -157,6 +220,10 @@ void simulate_mlfq(Thread threads[], int n) {
         }
         
         threads[idx].remaining_time -= exec_time;
+        if (timeline) {
+            timeline_run(timeline, level_names[threads[idx].current_queue], threads[idx].pid, idx,
+                         current_time, exec_time, threads[idx].remaining_time);
+        }
         current_time += exec_time;
         
         // Check for new arrivals during execution
@@ -173,15 +240,23 @@ void simulate_mlfq(Thread threads[], int n) {
                 threads[idx].first_response_time = current_time;
             }
             completed++;
+            if (timeline) timeline_mark(timeline, "finish", threads[idx].pid, idx, current_time);
         } else {
+            if (timeline) {
+                timeline_mark(timeline, (threads[idx].current_queue < 2) ? "demote" : "preempt",
+                              threads[idx].pid, idx, current_time);
+            }
+
             // Thread not finished, demote to next queue
             if (threads[idx].current_queue == 0) {
                 // Used full quantum in Q1, move to Q2
                 threads[idx].current_queue = 1;
+                STAT_INC(demotions);
                 enqueue(&q2, idx);
             } else if (threads[idx].current_queue == 1) {
                 // Used full quantum in Q2, move to Q3
                 threads[idx].current_queue = 2;
+                STAT_INC(demotions);
                 enqueue(&q3, idx);
             } else {
                 // Already in Q3, stay in Q3
@@ -189,35 +264,26 @@ void simulate_mlfq(Thread threads[], int n) {
             }
         }
     }
+    
+    STAT_STOP(PHASE_SIMULATE);
+    free_queue(&q1);
+    free_queue(&q2);
+    free_queue(&q3);
 }
 
 void aggregate_by_pid(Thread threads[], int n, Process processes[], int *num_processes) {
+    STAT_START(PHASE_AGGREGATE);
     *num_processes = 0;
     
-    // Initialize all processes as not found
-    for (int i = 0; i < MAX_PROCESSES; i++) {
-        processes[i].pid = -1;
-        processes[i].has_response = 0;
-        processes[i].first_start = -1;
-    }
-    
     // Aggregate threads by PID
     for (int i = 0; i < n; i++) {
-        int pid = threads[i].pid;
+        // Process indices follow first-seen order, so an unseen PID is always
+        // the next index
+        int proc_idx = threads[i].proc_idx;
         
-        // Find or create process entry
-        int proc_idx = -1;
-        for (int j = 0; j < *num_processes; j++) {
-            if (processes[j].pid == pid) {
-                proc_idx = j;
-                break;
-            }
-        }
-        
-        if (proc_idx == -1) {
+        if (proc_idx == *num_processes) {
             // New process
-            proc_idx = *num_processes;
-            processes[proc_idx].pid = pid;
+            processes[proc_idx].pid = threads[i].pid;
             processes[proc_idx].earliest_arrival = threads[i].arrival_time;
             processes[proc_idx].latest_finish = threads[i].finish_time;
             processes[proc_idx].first_start = threads[i].start_time;
@@ -252,21 +318,229 @@ void aggregate_by_pid(Thread threads[], int n, Process processes[], int *num_pro
         processes[i].turnaround_time = processes[i].latest_finish - processes[i].earliest_arrival;
         processes[i].waiting_time = processes[i].turnaround_time - processes[i].total_burst;
     }
+    STAT_STOP(PHASE_AGGREGATE);
+}
+
+int compare_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
 }
 
-int main() {
-    Thread threads[MAX_THREADS];
+// Nearest-rank percentile of an unsorted array (sorts it in place)
+double percentile(int values[], int count, double pct) {
+    qsort(values, count, sizeof(int), compare_int);
+    double exact = pct / 100.0 * count;
+    int rank = (int)exact;
+    if (rank < exact) rank++;
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return values[rank - 1];
+}
+
+void compute_metrics(Process processes[], int num_processes, Metrics *m) {
+    double total_waiting = 0, total_turnaround = 0, total_response = 0;
+    int max_finish_time = 0;
+    int *turnarounds = malloc(num_processes * sizeof(int));
+    int *responses = malloc(num_processes * sizeof(int));
+    
+    STAT_START(PHASE_AGGREGATE);
+    for (int i = 0; i < num_processes; i++) {
+        total_waiting += processes[i].waiting_time;
+        total_turnaround += processes[i].turnaround_time;
+        total_response += processes[i].response_time;
+        turnarounds[i] = processes[i].turnaround_time;
+        responses[i] = processes[i].response_time;
+        if (processes[i].latest_finish > max_finish_time) {
+            max_finish_time = processes[i].latest_finish;
+        }
+    }
+    
+    m->avg_waiting = total_waiting / num_processes;
+    m->avg_turnaround = total_turnaround / num_processes;
+    m->avg_response = total_response / num_processes;
+    m->throughput = (double)num_processes / max_finish_time;
+    m->p99_turnaround = percentile(turnarounds, num_processes, 99.0);
+    m->p99_response = percentile(responses, num_processes, 99.0);
+    
+    free(turnarounds);
+    free(responses);
+    STAT_STOP(PHASE_AGGREGATE);
+}
+
+int parse_objective(const char *name, Objective *obj) {
+    if (strcmp(name, "avg_wait") == 0) *obj = OBJ_AVG_WAIT;
+    else if (strcmp(name, "avg_tat") == 0) *obj = OBJ_AVG_TAT;
+    else if (strcmp(name, "avg_rt") == 0) *obj = OBJ_AVG_RT;
+    else if (strcmp(name, "p99_tat") == 0) *obj = OBJ_P99_TAT;
+    else if (strcmp(name, "p99_rt") == 0) *obj = OBJ_P99_RT;
+    else return 0;
+    return 1;
+}
+
+// Lower is better. Throughput is scaled per 10000 time units (same as the
+// plots) so a weight of 1 trades one time unit of latency for 0.0001 throughput
+double objective_cost(const Metrics *m, Objective obj, double throughput_weight) {
+    double value = 0;
+    switch (obj) {
+        case OBJ_AVG_WAIT: value = m->avg_waiting; break;
+        case OBJ_AVG_TAT: value = m->avg_turnaround; break;
+        case OBJ_AVG_RT: value = m->avg_response; break;
+        case OBJ_P99_TAT: value = m->p99_turnaround; break;
+        case OBJ_P99_RT: value = m->p99_response; break;
+    }
+    return value - throughput_weight * m->throughput * 10000;
+}
+
+void run_mlfq(Thread threads[], int n, int quantum_q1, int quantum_q2, const LatencyDist *dist,
+              Timeline *timeline, Process processes[], int *num_processes) {
+    Thread *sim_threads = malloc(n * sizeof(Thread));
+    memcpy(sim_threads, threads, n * sizeof(Thread));
+    simulate_mlfq(sim_threads, n, quantum_q1, quantum_q2, dist, timeline);
+    aggregate_by_pid(sim_threads, n, processes, num_processes);
+    free(sim_threads);
+}
+
+// Cost of a (Q1, Q2) pair, simulating it only the first time it is asked for
+double evaluate_pair(Optimizer *opt, int q1, int q2) {
+    if (!opt->evaluated[q1][q2]) {
+        Process *processes = opt->processes;
+        int num_processes = 0;
+        Metrics m;
+        run_mlfq(opt->threads, opt->n, q1, q2, opt->dist, NULL, processes, &num_processes);
+        compute_metrics(processes, num_processes, &m);
+        opt->cost[q1][q2] = objective_cost(&m, opt->objective, opt->throughput_weight);
+        opt->evaluated[q1][q2] = 1;
+        opt->evaluations++;
+    }
+    return opt->cost[q1][q2];
+}
+
+// Coarse-to-fine grid search over (Q1, Q2): scan a coarse grid, then shrink
+// the window around the best pair and refine the step until it reaches 1.
+void optimize_quanta(Optimizer *opt, int *best_q1, int *best_q2) {
+    int lo1 = MIN_QUANTUM, hi1 = MAX_QUANTUM;
+    int lo2 = MIN_QUANTUM, hi2 = MAX_QUANTUM;
+    int step = (MAX_QUANTUM - MIN_QUANTUM) / 8;
+    int b1 = QUANTUM_Q1, b2 = QUANTUM_Q2;
+    
+    if (step < 1) step = 1;
+    
+    while (1) {
+        for (int q1 = lo1; q1 <= hi1; q1 = (q1 < hi1 && q1 + step > hi1) ? hi1 : q1 + step) {
+            for (int q2 = lo2; q2 <= hi2; q2 = (q2 < hi2 && q2 + step > hi2) ? hi2 : q2 + step) {
+                if (evaluate_pair(opt, q1, q2) < evaluate_pair(opt, b1, b2)) {
+                    b1 = q1;
+                    b2 = q2;
+                }
+            }
+        }
+        
+        if (step == 1) break;
+        
+        lo1 = (b1 - step > MIN_QUANTUM) ? b1 - step : MIN_QUANTUM;
+        hi1 = (b1 + step < MAX_QUANTUM) ? b1 + step : MAX_QUANTUM;
+        lo2 = (b2 - step > MIN_QUANTUM) ? b2 - step : MIN_QUANTUM;
+        hi2 = (b2 + step < MAX_QUANTUM) ? b2 + step : MAX_QUANTUM;
+        step = (step / 4 > 1) ? step / 4 : 1;
+    }
+    
+    *best_q1 = b1;
+    *best_q2 = b2;
+}
+
+int run_optimizer(Thread threads[], int n, Objective objective, double throughput_weight,
+                  const LatencyDist *dist, Timeline *timeline, Process processes[]) {
+    Optimizer *opt = calloc(1, sizeof(Optimizer));
+    if (!opt) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    opt->threads = threads;
+    opt->n = n;
+    opt->objective = objective;
+    opt->throughput_weight = throughput_weight;
+    opt->dist = dist;
+    opt->processes = processes;
+    
+    int best_q1, best_q2;
+    optimize_quanta(opt, &best_q1, &best_q2);
+    
+    int num_processes = 0;
+    Metrics m;
+    run_mlfq(threads, n, best_q1, best_q2, dist, timeline, processes, &num_processes);
+    compute_metrics(processes, num_processes, &m);
+    if (timeline) timeline_close(timeline);
+    
+    int span = MAX_QUANTUM - MIN_QUANTUM + 1;
+    printf("Evaluated %d of %d (Q1, Q2) pairs\n", opt->evaluations, span * span);
+    printf("\nQuantum_Q1,Quantum_Q2,Throughput,Avg_Waiting_Time,Avg_Turnaround_Time,Avg_Response_Time,P99_Turnaround_Time,P99_Response_Time,Cost\n");
+    printf("%d,%d,%.6f,%.2f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+           best_q1, best_q2, m.throughput, m.avg_waiting, m.avg_turnaround, m.avg_response,
+           m.p99_turnaround, m.p99_response, opt->cost[best_q1][best_q2]);
+    
+    free(opt);
+    return 0;
+}
+
+void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--optimize=METRIC] [--throughput-weight=W]\n", prog);
+    fprintf(stderr, "          [--latency-dist=FILE] [--seed=N] [--timeline=FILE] [--stats[=json]] < input.csv\n");
+    fprintf(stderr, "  METRIC is one of avg_wait, avg_tat, avg_rt, p99_tat, p99_rt\n");
+}
+
+int main(int argc, char *argv[]) {
+    int capacity = 1024;
+    Thread *threads = malloc(capacity * sizeof(Thread));
     int n = 0;
     char line[MAX_LINE];
+    int optimize = 0;
+    Objective objective = OBJ_AVG_RT;
+    double throughput_weight = 0;
+    LatencyDist latency_dist;
+    const LatencyDist *dist = NULL;
+    const char *timeline_path = NULL;
+    StatsFormat stats_format = STATS_OFF;
+    Timeline *timeline = NULL;
+    
+    latency_dist.seed = 1;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--optimize=", 11) == 0) {
+            if (!parse_objective(argv[i] + 11, &objective)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            optimize = 1;
+        } else if (strncmp(argv[i], "--throughput-weight=", 20) == 0) {
+            throughput_weight = atof(argv[i] + 20);
+        } else if (strncmp(argv[i], "--latency-dist=", 15) == 0) {
+            if (!load_latency_dist(argv[i] + 15, &latency_dist)) return 1;
+            dist = &latency_dist;
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            latency_dist.seed = strtoull(argv[i] + 7, NULL, 10);
+        } else if (parse_stats_format(argv[i], &stats_format)) {
+            // --stats or --stats=json
+        } else if (strncmp(argv[i], "--timeline=", 11) == 0) {
+            timeline_path = argv[i] + 11;
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
     
     // Read header
+    STAT_START(PHASE_PARSE);
     if (fgets(line, MAX_LINE, stdin) == NULL) {
         fprintf(stderr, "Error reading header\n");
         return 1;
     }
     
     // Read all threads
-    while (fgets(line, MAX_LINE, stdin) != NULL && n < MAX_THREADS) {
+    while (fgets(line, MAX_LINE, stdin) != NULL) {
+        if (n == capacity) {
+            capacity *= 2;
+            threads = realloc(threads, capacity * sizeof(Thread));
+        }
         if (parse_line(line, &threads[n])) {
             n++;
         }
@@ -279,35 +553,56 @@ int main() {
     
     printf("Read %d threads\n", n);
     
+    // Process indices are assigned in arrival order, so sort first
+    int total_processes = sort_by_arrival(threads, n) ? index_processes(threads, n) : -1;
+    if (total_processes < 0) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    
+    // One process table, sized for this trace and reused by every simulation
+    Process *processes = malloc(total_processes * sizeof(Process));
+    STAT_STOP(PHASE_PARSE);
+    if (dist) {
+        printf("Dispatcher latency sampled from %d-bin measured distribution\n", dist->num_bins);
+    }
+    
+    // Opened once the trace has loaded, so an input error never leaves a
+    // partial timeline
+    if (timeline_path && !(timeline = timeline_open(timeline_path))) return 1;
+    
+    if (optimize) {
+        int status = run_optimizer(threads, n, objective, throughput_weight, dist, timeline, processes);
+        report_stats(stats_format, SIM_COUNTERS);
+        return status;
+    }
+    
     // Run simulation
-    simulate_mlfq(threads, n);
+    simulate_mlfq(threads, n, QUANTUM_Q1, QUANTUM_Q2, dist, timeline);
+    if (timeline) timeline_close(timeline);
     
     // Aggregate by PID
-    Process processes[MAX_PROCESSES];
     int num_processes = 0;
     aggregate_by_pid(threads, n, processes, &num_processes);
     
     // Calculate average metrics over PROCESSES (not threads)
-    double total_waiting = 0, total_turnaround = 0, total_response = 0;
-    int max_finish_time = 0;
-    
-    for (int i = 0; i < num_processes; i++) {
-        total_waiting += processes[i].waiting_time;
-        total_turnaround += processes[i].turnaround_time;
-        total_response += processes[i].response_time;
-        if (processes[i].latest_finish > max_finish_time) {
-            max_finish_time = processes[i].latest_finish;
-        }
-    }
-    
-    double avg_waiting = total_waiting / num_processes;
-    double avg_turnaround = total_turnaround / num_processes;
-    double avg_response = total_response / num_processes;
-    double throughput = (double)num_processes / max_finish_time;
+    Metrics m;
+    compute_metrics(processes, num_processes, &m);
     
     // Print results to terminal
+    STAT_START(PHASE_WRITE);
     printf("\nThroughput,Avg_Waiting_Time,Avg_Turnaround_Time,Avg_Response_Time\n");
-    printf("%.6f,%.2f,%.2f,%.2f\n", throughput, avg_waiting, avg_turnaround, avg_response);
+    printf("%.6f,%.2f,%.2f,%.2f\n", m.throughput, m.avg_waiting, m.avg_turnaround, m.avg_response);
+    
+    // One row for the FCFS/RR/MLFQ comparison in plot_results.py
+    NpyFile *summary_npy = npy_open("mlfq_results.npy", "<f8", sizeof(double), 1, SUMMARY_COLUMNS);
+    if (!summary_npy) return 1;
+    double row[SUMMARY_COLUMNS] = { QUANTUM_Q1, QUANTUM_Q2, m.throughput, m.avg_waiting, m.avg_turnaround,
+                                    m.avg_response, m.p99_turnaround, m.p99_response };
+    write_summary_row(summary_npy, 0, row);
+    npy_close(summary_npy);
+    STAT_STOP(PHASE_WRITE);
     
+    report_stats(stats_format, SIM_COUNTERS);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,621 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "stats.h"
+
+#define MAX_LINE 256
+#define MIN_QUANTUM 1
+#define MAX_QUANTUM 200
+#define DEFAULT_WEIGHT 1024
+#define VRUNTIME_SHIFT 20
+#define SUMMARY_COLUMNS 7
+
+// Counters the fair-share loop updates (groups are never demoted)
+#define SIM_COUNTERS (COUNT_LOOP_ITERATIONS | COUNT_DISPATCHES | COUNT_ENQUEUES | COUNT_DEQUEUES | COUNT_IDLE_JUMPS)
+
+typedef struct {
+    int pid;
+    int proc_idx;
+    int arrival_time;
+    int time_until_first_response;
+    int burst_length;
+    int remaining_time;
+    int start_time;
+    int finish_time;
+    int first_response_time;
+    int first_run;
+    int response_happened;
+    int next;               // next thread in its group's run queue
+} Thread;
+
+#include "trace.h"
+
+typedef struct {
+    int pid;
+    int earliest_arrival;
+    int latest_finish;
+    int first_start;
+    int total_burst;
+    int turnaround_time;
+    int waiting_time;
+    int response_time;
+    int has_response;
+} Process;
+
+#include "npy.h"
+
+// A scheduling group (one PID, or one thread with --group=thread). Its
+// runnable threads form an intrusive FIFO through Thread.next, and the group
+// sits in the run heap while that FIFO is non-empty.
+typedef struct {
+    int head;
+    int tail;
+    int weight;
+    int in_heap;
+    long long vruntime;     // CPU time received << VRUNTIME_SHIFT, scaled by DEFAULT_WEIGHT / weight
+    long long seq;          // FIFO order among equal vruntimes
+} Group;
+
+// Min-heap of runnable groups ordered by (vruntime, seq). Keys are copied
+// into the entries so sifting does not chase pointers into the group table.
+typedef struct {
+    long long vruntime;
+    long long seq;
+    int group_idx;
+} HeapEntry;
+
+typedef struct {
+    HeapEntry *entries;
+    int size;
+} RunHeap;
+
+typedef struct {
+    int pid;
+    int weight;
+} PidWeight;
+
+typedef struct {
+    double throughput;
+    double avg_waiting;
+    double avg_turnaround;
+    double avg_response;
+    double p99_turnaround;
+    double p99_response;
+} Metrics;
+
+int entry_before(const HeapEntry *a, const HeapEntry *b) {
+    if (a->vruntime != b->vruntime) return a->vruntime < b->vruntime;
+    return a->seq < b->seq;
+}
+
+void heap_push(RunHeap *h, Group groups[], int g) {
+    HeapEntry e;
+    e.vruntime = groups[g].vruntime;
+    e.seq = groups[g].seq;
+    e.group_idx = g;
+    
+    int i = h->size++;
+    while (i > 0 && entry_before(&e, &h->entries[(i - 1) / 2])) {
+        h->entries[i] = h->entries[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+    h->entries[i] = e;
+    groups[g].in_heap = 1;
+}
+
+int heap_pop(RunHeap *h, Group groups[]) {
+    int top = h->entries[0].group_idx;
+    HeapEntry last = h->entries[--h->size];
+    int i = 0;
+    
+    // Sift the last entry down from the root
+    while (2 * i + 1 < h->size) {
+        int child = 2 * i + 1;
+        if (child + 1 < h->size && entry_before(&h->entries[child + 1], &h->entries[child])) child++;
+        if (!entry_before(&h->entries[child], &last)) break;
+        h->entries[i] = h->entries[child];
+        i = child;
+    }
+    if (h->size > 0) h->entries[i] = last;
+    groups[top].in_heap = 0;
+    return top;
+}
+
+void group_append(Group *g, Thread threads[], int idx) {
+    STAT_INC(enqueues);
+    threads[idx].next = -1;
+    if (g->head == -1) g->head = idx;
+    else threads[g->tail].next = idx;
+    g->tail = idx;
+}
+
+int group_take(Group *g, Thread threads[]) {
+    STAT_INC(dequeues);
+    int idx = g->head;
+    g->head = threads[idx].next;
+    if (g->head == -1) g->tail = -1;
+    return idx;
+}
+
+int parse_line(char *line, Thread *t) {
+    char *token;
+    int field = 0;
+    
+    token = strtok(line, ",");
+    while (token != NULL && field < 4) {
+        switch(field) {
+            case 0: t->pid = atoi(token); break;
+            case 1: t->arrival_time = atoi(token); break;
+            case 2: t->time_until_first_response = atoi(token); break;
+            case 3: t->burst_length = atoi(token); break;
+        }
+        token = strtok(NULL, ",");
+        field++;
+    }
+    return field == 4;
+}
+
+// A thread joins its group's FIFO. A group that was idle re-enters the heap
+// no earlier than the current minimum vruntime, so sleeping does not bank
+// CPU credit (the same rule CFS uses).
+void make_runnable(int idx, Thread threads[], Group groups[], int group_of[], RunHeap *heap,
+                   long long min_vruntime, long long *seq) {
+    Group *g = &groups[group_of[idx]];
+    group_append(g, threads, idx);
+    if (!g->in_heap) {
+        if (g->vruntime < min_vruntime) g->vruntime = min_vruntime;
+        g->seq = (*seq)++;
+        heap_push(heap, groups, group_of[idx]);
+    }
+}
+
+// Two-level fair share: pick the group that has received the least weighted
+// CPU time, then round-robin among that group's runnable threads
+void simulate_fair_share(Thread threads[], int n, int quantum, Group groups[], int num_groups,
+                         int group_of[], const int weights[], const LatencyDist *dist) {
+    STAT_START(PHASE_SIMULATE);
+    RunHeap heap;
+    heap.entries = malloc(num_groups * sizeof(HeapEntry));
+    heap.size = 0;
+    
+    int current_time = 0;
+    int completed = 0;
+    int next_arrival_idx = 0;
+    long long min_vruntime = 0;
+    long long seq = 0;
+    unsigned long long rng = dist ? dist->seed : 0;
+    
+    // Initialize threads and groups
+    for (int i = 0; i < n; i++) {
+        threads[i].remaining_time = threads[i].burst_length;
+        threads[i].first_run = 1;
+        threads[i].start_time = -1;
+        threads[i].response_happened = 0;
+        threads[i].first_response_time = -1;
+    }
+    for (int g = 0; g < num_groups; g++) {
+        groups[g].head = -1;
+        groups[g].tail = -1;
+        groups[g].weight = weights[g];
+        groups[g].in_heap = 0;
+        groups[g].vruntime = 0;
+    }
+    
+    while (completed < n) {
+        STAT_INC(loop_iterations);
+        if (heap.size == 0) {
+            // CPU idle, jump to next arrival
+            STAT_INC(idle_jumps);
+            if (next_arrival_idx < n) {
+                if (current_time < threads[next_arrival_idx].arrival_time) {
+                    current_time = threads[next_arrival_idx].arrival_time;
+                }
+                while (next_arrival_idx < n && threads[next_arrival_idx].arrival_time <= current_time) {
+                    make_runnable(next_arrival_idx, threads, groups, group_of, &heap, min_vruntime, &seq);
+                    next_arrival_idx++;
+                }
+            }
+            continue;
+        }
+        
+        // Add dispatcher latency
+        current_time += dispatch_latency(dist, &rng);
+        STAT_INC(dispatches);
+        
+        // Least-served group, then the thread at the head of its queue
+        int g = heap_pop(&heap, groups);
+        int idx = group_take(&groups[g], threads);
+        min_vruntime = groups[g].vruntime;
+        
+        // Record start time if first run
+        if (threads[idx].first_run) {
+            threads[idx].start_time = current_time;
+            threads[idx].first_run = 0;
+        }
+        
+        // Execute for quantum or remaining time, whichever is smaller
+        int exec_time = (threads[idx].remaining_time < quantum) ?
+                        threads[idx].remaining_time : quantum;
+        
+        // Check if response happens during this execution
+        if (!threads[idx].response_happened &&
+            threads[idx].time_until_first_response < exec_time) {
+            threads[idx].first_response_time = current_time + threads[idx].time_until_first_response;
+            threads[idx].response_happened = 1;
+        }
+        
+        threads[idx].remaining_time -= exec_time;
+        current_time += exec_time;
+        // Fixed point, so a slice shorter than weight / DEFAULT_WEIGHT still
+        // advances a heavy group instead of truncating to 0
+        groups[g].vruntime += ((long long)exec_time << VRUNTIME_SHIFT) * DEFAULT_WEIGHT / groups[g].weight;
+        
+        // Check for new arrivals during execution
+        while (next_arrival_idx < n && threads[next_arrival_idx].arrival_time <= current_time) {
+            make_runnable(next_arrival_idx, threads, groups, group_of, &heap, min_vruntime, &seq);
+            next_arrival_idx++;
+        }
+        
+        // Check if thread completed
+        if (threads[idx].remaining_time == 0) {
+            threads[idx].finish_time = current_time;
+            // If response never happened, set it to finish time
+            if (!threads[idx].response_happened) {
+                threads[idx].first_response_time = current_time;
+            }
+            completed++;
+        } else {
+            // Thread not finished, back to the tail of its group
+            group_append(&groups[g], threads, idx);
+        }
+        
+        // Requeue the group behind its peers if it still has work
+        if (groups[g].head != -1 && !groups[g].in_heap) {
+            groups[g].seq = seq++;
+            heap_push(&heap, groups, g);
+        }
+    }
+    
+    STAT_STOP(PHASE_SIMULATE);
+    free(heap.entries);
+}
+
+void aggregate_by_pid(Thread threads[], int n, Process processes[], int *num_processes) {
+    STAT_START(PHASE_AGGREGATE);
+    *num_processes = 0;
+    
+    // Aggregate threads by PID
+    for (int i = 0; i < n; i++) {
+        // Process indices follow first-seen order, so an unseen PID is always
+        // the next index
+        int proc_idx = threads[i].proc_idx;
+        
+        if (proc_idx == *num_processes) {
+            // New process
+            processes[proc_idx].pid = threads[i].pid;
+            processes[proc_idx].earliest_arrival = threads[i].arrival_time;
+            processes[proc_idx].latest_finish = threads[i].finish_time;
+            processes[proc_idx].first_start = threads[i].start_time;
+            processes[proc_idx].total_burst = threads[i].burst_length;
+            processes[proc_idx].response_time = threads[i].first_response_time - threads[i].arrival_time;
+            processes[proc_idx].has_response = 1;
+            (*num_processes)++;
+        } else {
+            // Update existing process
+            if (threads[i].arrival_time < processes[proc_idx].earliest_arrival) {
+                processes[proc_idx].earliest_arrival = threads[i].arrival_time;
+            }
+            if (threads[i].finish_time > processes[proc_idx].latest_finish) {
+                processes[proc_idx].latest_finish = threads[i].finish_time;
+            }
+            if (processes[proc_idx].first_start == -1 || threads[i].start_time < processes[proc_idx].first_start) {
+                processes[proc_idx].first_start = threads[i].start_time;
+            }
+            processes[proc_idx].total_burst += threads[i].burst_length;
+            
+            // Update response time if this thread has earlier first response
+            int thread_response = threads[i].first_response_time - processes[proc_idx].earliest_arrival;
+            if (!processes[proc_idx].has_response || thread_response < processes[proc_idx].response_time) {
+                processes[proc_idx].response_time = thread_response;
+                processes[proc_idx].has_response = 1;
+            }
+        }
+    }
+    
+    // Calculate turnaround and waiting for each process
+    for (int i = 0; i < *num_processes; i++) {
+        processes[i].turnaround_time = processes[i].latest_finish - processes[i].earliest_arrival;
+        processes[i].waiting_time = processes[i].turnaround_time - processes[i].total_burst;
+    }
+    STAT_STOP(PHASE_AGGREGATE);
+}
+
+void write_detail_results(FILE *fp, int quantum, Process processes[], int num_processes) {
+    STAT_START(PHASE_WRITE);
+    for (int i = 0; i < num_processes; i++) {
+        fprintf(fp, "%d,%d,%d,%d,%d,%d,%d,%d\n",
+                quantum,
+                processes[i].pid,
+                processes[i].earliest_arrival,
+                processes[i].first_start,
+                processes[i].latest_finish,
+                processes[i].turnaround_time,
+                processes[i].waiting_time,
+                processes[i].response_time);
+    }
+    STAT_STOP(PHASE_WRITE);
+}
+
+int compare_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of an unsorted array (sorts it in place)
+double percentile(int values[], int count, double pct) {
+    qsort(values, count, sizeof(int), compare_int);
+    double exact = pct / 100.0 * count;
+    int rank = (int)exact;
+    if (rank < exact) rank++;
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return values[rank - 1];
+}
+
+void compute_metrics(Process processes[], int num_processes, Metrics *m) {
+    double total_waiting = 0, total_turnaround = 0, total_response = 0;
+    int max_finish_time = 0;
+    int *turnarounds = malloc(num_processes * sizeof(int));
+    int *responses = malloc(num_processes * sizeof(int));
+    
+    STAT_START(PHASE_AGGREGATE);
+    for (int i = 0; i < num_processes; i++) {
+        total_waiting += processes[i].waiting_time;
+        total_turnaround += processes[i].turnaround_time;
+        total_response += processes[i].response_time;
+        turnarounds[i] = processes[i].turnaround_time;
+        responses[i] = processes[i].response_time;
+        if (processes[i].latest_finish > max_finish_time) {
+            max_finish_time = processes[i].latest_finish;
+        }
+    }
+    
+    m->avg_waiting = total_waiting / num_processes;
+    m->avg_turnaround = total_turnaround / num_processes;
+    m->avg_response = total_response / num_processes;
+    m->throughput = (double)num_processes / max_finish_time;
+    m->p99_turnaround = percentile(turnarounds, num_processes, 99.0);
+    m->p99_response = percentile(responses, num_processes, 99.0);
+    
+    free(turnarounds);
+    free(responses);
+    STAT_STOP(PHASE_AGGREGATE);
+}
+
+int compare_pid_weight(const void *a, const void *b) {
+    int x = ((const PidWeight *)a)->pid, y = ((const PidWeight *)b)->pid;
+    return (x > y) - (x < y);
+}
+
+// "Pid,Weight" rows; PIDs not listed get DEFAULT_WEIGHT. Sorted by PID so
+// each process can be looked up with a binary search.
+PidWeight *load_weights(const char *path, int *count) {
+    FILE *fp = fopen(path, "r");
+    char line[MAX_LINE];
+    int capacity = 64;
+    PidWeight *weights;
+    
+    if (!fp) {
+        fprintf(stderr, "Error opening %s\n", path);
+        return NULL;
+    }
+    
+    // Skip "Pid,Weight" header
+    if (fgets(line, MAX_LINE, fp) == NULL) {
+        fclose(fp);
+        return NULL;
+    }
+    
+    weights = malloc(capacity * sizeof(PidWeight));
+    *count = 0;
+    while (fgets(line, MAX_LINE, fp) != NULL) {
+        int pid, weight;
+        if (sscanf(line, "%d,%d", &pid, &weight) == 2 && weight > 0) {
+            if (*count == capacity) {
+                capacity *= 2;
+                weights = realloc(weights, capacity * sizeof(PidWeight));
+            }
+            weights[*count].pid = pid;
+            weights[*count].weight = weight;
+            (*count)++;
+        }
+    }
+    fclose(fp);
+    
+    qsort(weights, *count, sizeof(PidWeight), compare_pid_weight);
+    return weights;
+}
+
+int lookup_weight(const PidWeight weights[], int count, int pid) {
+    PidWeight key;
+    key.pid = pid;
+    const PidWeight *found = weights ? bsearch(&key, weights, count, sizeof(PidWeight), compare_pid_weight) : NULL;
+    return found ? found->weight : DEFAULT_WEIGHT;
+}
+
+void run_fair_share(Thread threads[], int n, int quantum, Group groups[], int num_groups,
+                    int group_of[], const int weights[], const LatencyDist *dist,
+                    Process processes[], int *num_processes) {
+    Thread *sim_threads = malloc(n * sizeof(Thread));
+    memcpy(sim_threads, threads, n * sizeof(Thread));
+    simulate_fair_share(sim_threads, n, quantum, groups, num_groups, group_of, weights, dist);
+    aggregate_by_pid(sim_threads, n, processes, num_processes);
+    free(sim_threads);
+}
+
+void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--group=pid|thread] [--weights=FILE]\n", prog);
+    fprintf(stderr, "          [--latency-dist=FILE] [--seed=N] [--stats[=json]] < input.csv\n");
+}
+
+int main(int argc, char *argv[]) {
+    int capacity = 1024;
+    Thread *threads = malloc(capacity * sizeof(Thread));
+    int n = 0;
+    char line[MAX_LINE];
+    int group_by_thread = 0;
+    PidWeight *pid_weights = NULL;
+    int num_pid_weights = 0;
+    LatencyDist latency_dist;
+    const LatencyDist *dist = NULL;
+    StatsFormat stats_format = STATS_OFF;
+    
+    latency_dist.seed = 1;
+    
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--group=pid") == 0) {
+            group_by_thread = 0;
+        } else if (strcmp(argv[i], "--group=thread") == 0) {
+            group_by_thread = 1;
+        } else if (strncmp(argv[i], "--weights=", 10) == 0) {
+            pid_weights = load_weights(argv[i] + 10, &num_pid_weights);
+            if (!pid_weights) return 1;
+        } else if (strncmp(argv[i], "--latency-dist=", 15) == 0) {
+            if (!load_latency_dist(argv[i] + 15, &latency_dist)) return 1;
+            dist = &latency_dist;
+        } else if (strncmp(argv[i], "--seed=", 7) == 0) {
+            latency_dist.seed = strtoull(argv[i] + 7, NULL, 10);
+        } else if (parse_stats_format(argv[i], &stats_format)) {
+            // --stats or --stats=json
+        } else {
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    
+    // Read header
+    STAT_START(PHASE_PARSE);
+    if (fgets(line, MAX_LINE, stdin) == NULL) {
+        fprintf(stderr, "Error reading header\n");
+        return 1;
+    }
+    
+    // Read all threads
+    while (fgets(line, MAX_LINE, stdin) != NULL) {
+        if (n == capacity) {
+            capacity *= 2;
+            threads = realloc(threads, capacity * sizeof(Thread));
+        }
+        if (parse_line(line, &threads[n])) {
+            n++;
+        }
+    }
+    
+    if (n == 0) {
+        fprintf(stderr, "No threads read\n");
+        return 1;
+    }
+    
+    printf("Read %d threads\n", n);
+    
+    // Process indices are assigned in arrival order, so sort first
+    int total_processes = sort_by_arrival(threads, n) ? index_processes(threads, n) : -1;
+    if (total_processes < 0) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    
+    // One process table, sized for this trace and reused by every simulation
+    Process *processes = malloc(total_processes * sizeof(Process));
+    STAT_STOP(PHASE_PARSE);
+    if (dist) {
+        printf("Dispatcher latency sampled from %d-bin measured distribution\n", dist->num_bins);
+    }
+    
+    // Groups are PIDs, or single threads as the ungrouped baseline. Either way
+    // a group's weight is its PID's weight.
+    int num_groups = group_by_thread ? n : total_processes;
+    Group *groups = malloc(num_groups * sizeof(Group));
+    int *group_of = malloc(n * sizeof(int));
+    int *weights = malloc(num_groups * sizeof(int));
+    for (int i = 0; i < n; i++) {
+        group_of[i] = group_by_thread ? i : threads[i].proc_idx;
+        weights[group_of[i]] = lookup_weight(pid_weights, num_pid_weights, threads[i].pid);
+    }
+    printf("Fair share across %d %s\n", num_groups, group_by_thread ? "threads" : "processes");
+    
+    // Open output files
+    const char *detail_name = group_by_thread ? "fs_thread_results_details.csv" : "fs_results_details.csv";
+    const char *summary_name = group_by_thread ? "fs_thread_results.csv" : "fs_results.csv";
+    const char *detail_npy_name = group_by_thread ? "fs_thread_results_details.npy" : "fs_results_details.npy";
+    const char *summary_npy_name = group_by_thread ? "fs_thread_results.npy" : "fs_results.npy";
+    FILE *detail_fp = fopen(detail_name, "w");
+    FILE *summary_fp = fopen(summary_name, "w");
+    
+    if (!detail_fp || !summary_fp) {
+        fprintf(stderr, "Error opening output files\n");
+        return 1;
+    }
+    
+    // Columnar copies of both tables for plot_results.py
+    int sweep_points = MAX_QUANTUM - MIN_QUANTUM + 1;
+    NpyFile *detail_npy = npy_open(detail_npy_name, "<i4", sizeof(int),
+                                   (long long)sweep_points * total_processes, DETAIL_COLUMNS);
+    NpyFile *summary_npy = npy_open(summary_npy_name, "<f8", sizeof(double), sweep_points, SUMMARY_COLUMNS);
+    if (!detail_npy || !summary_npy) return 1;
+    
+    // Write headers
+    fprintf(detail_fp, "Quantum_Size,Pid,Arrival_Time,Start_Time,Finish_Time,Turnaround_Time,Waiting_Time,Response_Time\n");
+    fprintf(summary_fp, "Quantum_Size,Throughput,Avg_Waiting_Time,Avg_Turnaround_Time,Avg_Response_Time,P99_Turnaround_Time,P99_Response_Time\n");
+    
+    // Run simulations for quantum 1 to 200
+    for (int quantum = MIN_QUANTUM; quantum <= MAX_QUANTUM; quantum++) {
+        // Simulate on a copy of the threads and aggregate by PID
+        int num_processes = 0;
+        run_fair_share(threads, n, quantum, groups, num_groups, group_of, weights, dist,
+                       processes, &num_processes);
+        
+        // Write detailed results
+        write_detail_results(detail_fp, quantum, processes, num_processes);
+        write_detail_columns(detail_npy, quantum - MIN_QUANTUM, quantum, processes, num_processes);
+        
+        // Calculate average and tail metrics over PROCESSES (not threads)
+        Metrics m;
+        compute_metrics(processes, num_processes, &m);
+        
+        // Write summary results
+        STAT_START(PHASE_WRITE);
+        fprintf(summary_fp, "%d,%.6f,%.2f,%.2f,%.2f,%.2f,%.2f\n",
+                quantum, m.throughput, m.avg_waiting, m.avg_turnaround, m.avg_response,
+                m.p99_turnaround, m.p99_response);
+        double row[SUMMARY_COLUMNS] = { quantum, m.throughput, m.avg_waiting, m.avg_turnaround, m.avg_response,
+                                        m.p99_turnaround, m.p99_response };
+        write_summary_row(summary_npy, quantum - MIN_QUANTUM, row);
+        STAT_STOP(PHASE_WRITE);
+        
+        // Print progress
+        if (quantum % 50 == 0 || quantum == 1) {
+            printf("Completed quantum %d: Throughput=%.6f, Avg_Wait=%.2f, Avg_TAT=%.2f, Avg_RT=%.2f, P99_TAT=%.2f, P99_RT=%.2f\n",
+                   quantum, m.throughput, m.avg_waiting, m.avg_turnaround, m.avg_response,
+                   m.p99_turnaround, m.p99_response);
+        }
+    }
+    
+    fclose(detail_fp);
+    fclose(summary_fp);
+    npy_close(detail_npy);
+    npy_close(summary_npy);
+    
+    printf("\nFair-share simulation completed! Results saved to %s\n", summary_name);
+    printf("Process table results saved to %s\n", detail_name);
+    
+    free(groups);
+    free(group_of);
+    free(weights);
+    free(pid_weights);
+    free(processes);
+    free(threads);
+    report_stats(stats_format, SIM_COUNTERS);
+    return 0;
+}
@@ -0,0 +1,1160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#define MAX_LINE 256
+#define MAX_TRACES 16
+#define MAX_NAME 64
+#define DEFAULT_WORKERS 4
+#define REQUEST_QUEUE_SIZE 64
+#define MAX_CONNECTIONS 256
+#define MAX_PENDING 8
+#define REPLY_SIZE 1024
+#define CACHE_SIZE 4096
+#define DEFAULT_LATENCY 20
+#define DEFAULT_QUANTUM_Q1 40
+#define DEFAULT_QUANTUM_Q2 80
+
+typedef struct {
+    int pid;
+    int proc_idx;
+    int arrival_time;
+    int time_until_first_response;
+    int burst_length;
+    int remaining_time;
+    int start_time;
+    int finish_time;
+    int first_response_time;
+    int first_run;
+    int response_happened;
+    int current_queue;
+} Thread;
+
+#include "trace.h"
+
+typedef struct {
+    int pid;
+    int earliest_arrival;
+    int latest_finish;
+    int first_start;
+    int total_burst;
+    int turnaround_time;
+    int waiting_time;
+    int response_time;
+    int has_response;
+} Process;
+
+typedef struct {
+    double throughput;
+    double avg_waiting;
+    double avg_turnaround;
+    double avg_response;
+    double p99_turnaround;
+    double p99_response;
+} Metrics;
+
+// A trace is loaded once at startup and never modified afterwards, so
+// workers can read it without locking
+typedef struct {
+    char name[MAX_NAME];
+    Thread *threads;
+    int n;
+    int num_processes;
+} Trace;
+
+typedef enum {
+    POLICY_FCFS,
+    POLICY_RR,
+    POLICY_MLFQ
+} Policy;
+
+typedef struct {
+    int trace_idx;
+    Policy policy;
+    int latency;
+    int quantum_q1;
+    int quantum_q2;
+} QueryKey;
+
+// Direct-mapped result cache: a colliding query simply replaces the old entry
+typedef struct {
+    int valid;
+    QueryKey key;
+    Metrics metrics;
+} CacheEntry;
+
+typedef struct {
+    int *thread_idx;
+    int capacity;
+    int front;
+    int rear;
+    int size;
+} Queue;
+
+// A client connection. The fields above the lock belong to the main (poll)
+// thread, which does all socket I/O. Requests are numbered as they are read;
+// workers may finish them in any order, but replies are written in request
+// order, so a client can pipeline up to MAX_PENDING requests and still match
+// replies to requests. A request stays in flight until its reply has been
+// written out, so a client that stops reading stops being read from once
+// its MAX_PENDING slots are full, and holds no more memory than that.
+typedef struct {
+    int fd;
+    char buffer[MAX_LINE];
+    int used;
+    int discarding;
+    int eof;
+    int broken;             // write failed: replies are dropped, not sent
+    size_t sent;            // bytes of the next reply already written
+    unsigned long next_seq;
+    
+    pthread_mutex_t lock;
+    unsigned long next_reply;
+    int in_flight;
+    int ready[MAX_PENDING];
+    char replies[MAX_PENDING][REPLY_SIZE];
+} Connection;
+
+// One request line waiting for a worker
+typedef struct {
+    Connection *conn;
+    unsigned long seq;
+    int too_long;
+    char line[MAX_LINE];
+} Request;
+
+typedef struct {
+    Request requests[REQUEST_QUEUE_SIZE];
+    int front;
+    int size;
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+} RequestQueue;
+
+Trace traces[MAX_TRACES];
+int num_traces = 0;
+
+CacheEntry cache[CACHE_SIZE];
+pthread_mutex_t cache_lock = PTHREAD_MUTEX_INITIALIZER;
+
+RequestQueue request_queue = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .not_empty = PTHREAD_COND_INITIALIZER,
+    .not_full = PTHREAD_COND_INITIALIZER
+};
+
+const char *socket_path = NULL;
+
+// Workers write a byte here whenever a reply is ready, so the poll loop
+// sends it
+int wake_pipe[2];
+
+int init_queue(Queue *q, int capacity) {
+    q->thread_idx = malloc(capacity * sizeof(int));
+    q->capacity = capacity;
+    q->front = 0;
+    q->rear = -1;
+    q->size = 0;
+    return q->thread_idx != NULL;
+}
+
+void free_queue(Queue *q) {
+    free(q->thread_idx);
+}
+
+void enqueue(Queue *q, int idx) {
+    q->rear = (q->rear + 1) % q->capacity;
+    q->thread_idx[q->rear] = idx;
+    q->size++;
+}
+
+int dequeue(Queue *q) {
+    if (q->size == 0) return -1;
+    int idx = q->thread_idx[q->front];
+    q->front = (q->front + 1) % q->capacity;
+    q->size--;
+    return idx;
+}
+
+int is_empty(Queue *q) {
+    return q->size == 0;
+}
+
+int parse_line(char *line, Thread *t) {
+    char *token;
+    char *save;
+    int field = 0;
+    
+    token = strtok_r(line, ",", &save);
+    while (token != NULL && field < 4) {
+        switch(field) {
+            case 0: t->pid = atoi(token); break;
+            case 1: t->arrival_time = atoi(token); break;
+            case 2: t->time_until_first_response = atoi(token); break;
+            case 3: t->burst_length = atoi(token); break;
+        }
+        token = strtok_r(NULL, ",", &save);
+        field++;
+    }
+    return field == 4;
+}
+
+int load_trace(const char *name, const char *path) {
+    if (num_traces == MAX_TRACES) {
+        fprintf(stderr, "Too many traces (max %d)\n", MAX_TRACES);
+        return 0;
+    }
+    
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "Error opening %s\n", path);
+        return 0;
+    }
+    
+    Trace *trace = &traces[num_traces];
+    char line[MAX_LINE];
+    int capacity = 1024;
+    
+    snprintf(trace->name, MAX_NAME, "%s", name);
+    trace->threads = malloc(capacity * sizeof(Thread));
+    trace->n = 0;
+    if (!trace->threads) {
+        fprintf(stderr, "Out of memory loading %s\n", path);
+        fclose(fp);
+        return 0;
+    }
+    
+    // Skip header
+    if (fgets(line, MAX_LINE, fp) == NULL) {
+        fprintf(stderr, "Error reading header of %s\n", path);
+        fclose(fp);
+        free(trace->threads);
+        return 0;
+    }
+    
+    while (fgets(line, MAX_LINE, fp) != NULL) {
+        if (trace->n == capacity) {
+            Thread *grown = realloc(trace->threads, 2 * capacity * sizeof(Thread));
+            if (!grown) {
+                fprintf(stderr, "Out of memory loading %s (%d threads read)\n", path, trace->n);
+                fclose(fp);
+                free(trace->threads);
+                return 0;
+            }
+            trace->threads = grown;
+            capacity *= 2;
+        }
+        if (parse_line(line, &trace->threads[trace->n])) {
+            trace->n++;
+        }
+    }
+    fclose(fp);
+    
+    if (trace->n == 0) {
+        fprintf(stderr, "No threads read from %s\n", path);
+        free(trace->threads);
+        return 0;
+    }
+    
+    trace->num_processes = sort_by_arrival(trace->threads, trace->n) ? index_processes(trace->threads, trace->n) : -1;
+    if (trace->num_processes < 0) {
+        fprintf(stderr, "Out of memory loading %s\n", path);
+        free(trace->threads);
+        return 0;
+    }
+    printf("Loaded trace '%s': %d threads, %d processes\n", trace->name, trace->n, trace->num_processes);
+    num_traces++;
+    return 1;
+}
+
+int find_trace(const char *name) {
+    for (int i = 0; i < num_traces; i++) {
+        if (strcmp(traces[i].name, name) == 0) return i;
+    }
+    return -1;
+}
+
+int simulate_fcfs(Thread threads[], int n, int latency) {
+    int current_time = 0;
+    
+    for (int i = 0; i < n; i++) {
+        // Wait for thread to arrive if CPU idle
+        if (current_time < threads[i].arrival_time) {
+            current_time = threads[i].arrival_time;
+        }
+        
+        current_time += latency;
+        threads[i].start_time = current_time;
+        threads[i].first_response_time = current_time + threads[i].time_until_first_response;
+        current_time += threads[i].burst_length;
+        threads[i].finish_time = current_time;
+    }
+    return 1;
+}
+
+int simulate_rr(Thread threads[], int n, int latency, int quantum) {
+    Queue ready_queue;
+    if (!init_queue(&ready_queue, n)) return 0;
+    
+    int current_time = 0;
+    int completed = 0;
+    int next_arrival_idx = 0;
+    
+    // Initialize threads
+    for (int i = 0; i < n; i++) {
+        threads[i].remaining_time = threads[i].burst_length;
+        threads[i].first_run = 1;
+        threads[i].start_time = -1;
+        threads[i].response_happened = 0;
+        threads[i].first_response_time = -1;
+    }
+    
+    // Add threads that arrive at time 0
+    while (next_arrival_idx < n && threads[next_arrival_idx].arrival_time <= current_time) {
+        enqueue(&ready_queue, next_arrival_idx);
+        next_arrival_idx++;
+    }
+    
+    while (completed < n) {
+        if (is_empty(&ready_queue)) {
+            // CPU idle, jump to next arrival
+            if (next_arrival_idx < n) {
+                current_time = threads[next_arrival_idx].arrival_time;
+                while (next_arrival_idx < n && threads[next_arrival_idx].arrival_time <= current_time) {
+                    enqueue(&ready_queue, next_arrival_idx);
+                    next_arrival_idx++;
+                }
+            }
+            continue;
+        }
+        
+        current_time += latency;
+        int idx = dequeue(&ready_queue);
+        
+        if (threads[idx].first_run) {
+            threads[idx].start_time = current_time;
+            threads[idx].first_run = 0;
+        }
+        
+        int exec_time = (threads[idx].remaining_time < quantum) ?
+                        threads[idx].remaining_time : quantum;
+        
+        if (!threads[idx].response_happened &&
+            threads[idx].time_until_first_response < exec_time) {
+            threads[idx].first_response_time = current_time + threads[idx].time_until_first_response;
+            threads[idx].response_happened = 1;
+        }
+        
+        threads[idx].remaining_time -= exec_time;
+        current_time += exec_time;
+        
+        while (next_arrival_idx < n && threads[next_arrival_idx].arrival_time <= current_time) {
+            enqueue(&ready_queue, next_arrival_idx);
+            next_arrival_idx++;
+        }
+        
+        if (threads[idx].remaining_time == 0) {
+            threads[idx].finish_time = current_time;
+            if (!threads[idx].response_happened) {
+                threads[idx].first_response_time = current_time;
+            }
+            completed++;
+        } else {
+            enqueue(&ready_queue, idx);
+        }
+    }
+    
+    free_queue(&ready_queue);
+    return 1;
+}
+
+int simulate_mlfq(Thread threads[], int n, int latency, int quantum_q1, int quantum_q2) {
+    Queue q1, q2, q3;
+    int ok = init_queue(&q1, n);
+    ok = init_queue(&q2, n) && ok;
+    ok = init_queue(&q3, n) && ok;
+    if (!ok) {
+        free_queue(&q1);
+        free_queue(&q2);
+        free_queue(&q3);
+        return 0;
+    }
+    
+    int current_time = 0;
+    int completed = 0;
+    int next_arrival_idx = 0;
+    
+    // Initialize threads
+    for (int i = 0; i < n; i++) {
+        threads[i].remaining_time = threads[i].burst_length;
+        threads[i].first_run = 1;
+        threads[i].start_time = -1;
+        threads[i].current_queue = 0;
+        threads[i].response_happened = 0;
+        threads[i].first_response_time = -1;
+    }
+    
+    // Add threads that arrive at time 0
+    while (next_arrival_idx < n && threads[next_arrival_idx].arrival_time <= current_time) {
+        enqueue(&q1, next_arrival_idx);
+        next_arrival_idx++;
+    }
+    
+    while (completed < n) {
+        int idx = -1;
+        int quantum = 0;
+        
+        // Priority: Q1 > Q2 > Q3
+        if (!is_empty(&q1)) {
+            idx = dequeue(&q1);
+            quantum = quantum_q1;
+        } else if (!is_empty(&q2)) {
+            idx = dequeue(&q2);
+            quantum = quantum_q2;
+        } else if (!is_empty(&q3)) {
+            idx = dequeue(&q3);
+            quantum = threads[idx].remaining_time;
+        } else {
+            // CPU idle, jump to next arrival
+            if (next_arrival_idx < n) {
+                current_time = threads[next_arrival_idx].arrival_time;
+                while (next_arrival_idx < n && threads[next_arrival_idx].arrival_time <= current_time) {
+                    enqueue(&q1, next_arrival_idx);
+                    next_arrival_idx++;
+                }
+            }
+            continue;
+        }
+        
+        current_time += latency;
+        
+        if (threads[idx].first_run) {
+            threads[idx].start_time = current_time;
+            threads[idx].first_run = 0;
+        }
+        
+        int exec_time = (threads[idx].remaining_time < quantum) ?
+                        threads[idx].remaining_time : quantum;
+        
+        if (!threads[idx].response_happened &&
+            threads[idx].time_until_first_response < exec_time) {
+            threads[idx].first_response_time = current_time + threads[idx].time_until_first_response;
+            threads[idx].response_happened = 1;
+        }
+        
+        threads[idx].remaining_time -= exec_time;
+        current_time += exec_time;
+        
+        while (next_arrival_idx < n && threads[next_arrival_idx].arrival_time <= current_time) {
+            enqueue(&q1, next_arrival_idx);
+            next_arrival_idx++;
+        }
+        
+        if (threads[idx].remaining_time == 0) {
+            threads[idx].finish_time = current_time;
+            if (!threads[idx].response_happened) {
+                threads[idx].first_response_time = current_time;
+            }
+            completed++;
+        } else if (threads[idx].current_queue == 0) {
+            threads[idx].current_queue = 1;
+            enqueue(&q2, idx);
+        } else {
+            threads[idx].current_queue = 2;
+            enqueue(&q3, idx);
+        }
+    }
+    
+    free_queue(&q1);
+    free_queue(&q2);
+    free_queue(&q3);
+    return 1;
+}
+
+// Same per-PID rules as aggregate_by_pid() in a2p1-a2p3, using the process
+// index assigned at load time
+void aggregate_by_pid(Thread threads[], int n, Process processes[], int num_processes) {
+    for (int i = 0; i < num_processes; i++) {
+        processes[i].pid = -1;
+        processes[i].has_response = 0;
+    }
+    
+    for (int i = 0; i < n; i++) {
+        Process *p = &processes[threads[i].proc_idx];
+        
+        if (p->pid == -1) {
+            p->pid = threads[i].pid;
+            p->earliest_arrival = threads[i].arrival_time;
+            p->latest_finish = threads[i].finish_time;
+            p->first_start = threads[i].start_time;
+            p->total_burst = threads[i].burst_length;
+            p->response_time = threads[i].first_response_time - threads[i].arrival_time;
+            p->has_response = 1;
+        } else {
+            if (threads[i].arrival_time < p->earliest_arrival) {
+                p->earliest_arrival = threads[i].arrival_time;
+            }
+            if (threads[i].finish_time > p->latest_finish) {
+                p->latest_finish = threads[i].finish_time;
+            }
+            if (threads[i].start_time < p->first_start) {
+                p->first_start = threads[i].start_time;
+            }
+            p->total_burst += threads[i].burst_length;
+            
+            int thread_response = threads[i].first_response_time - p->earliest_arrival;
+            if (thread_response < p->response_time) {
+                p->response_time = thread_response;
+            }
+        }
+    }
+    
+    for (int i = 0; i < num_processes; i++) {
+        processes[i].turnaround_time = processes[i].latest_finish - processes[i].earliest_arrival;
+        processes[i].waiting_time = processes[i].turnaround_time - processes[i].total_burst;
+    }
+}
+
+int compare_int(const void *a, const void *b) {
+    int x = *(const int *)a, y = *(const int *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of an unsorted array (sorts it in place)
+double percentile(int values[], int count, double pct) {
+    qsort(values, count, sizeof(int), compare_int);
+    double exact = pct / 100.0 * count;
+    int rank = (int)exact;
+    if (rank < exact) rank++;
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+    return values[rank - 1];
+}
+
+int compute_metrics(Process processes[], int num_processes, Metrics *m) {
+    double total_waiting = 0, total_turnaround = 0, total_response = 0;
+    int max_finish_time = 0;
+    int *turnarounds = malloc(num_processes * sizeof(int));
+    int *responses = malloc(num_processes * sizeof(int));
+    
+    if (!turnarounds || !responses) {
+        free(turnarounds);
+        free(responses);
+        return 0;
+    }
+    
+    for (int i = 0; i < num_processes; i++) {
+        total_waiting += processes[i].waiting_time;
+        total_turnaround += processes[i].turnaround_time;
+        total_response += processes[i].response_time;
+        turnarounds[i] = processes[i].turnaround_time;
+        responses[i] = processes[i].response_time;
+        if (processes[i].latest_finish > max_finish_time) {
+            max_finish_time = processes[i].latest_finish;
+        }
+    }
+    
+    m->avg_waiting = total_waiting / num_processes;
+    m->avg_turnaround = total_turnaround / num_processes;
+    m->avg_response = total_response / num_processes;
+    m->throughput = (double)num_processes / max_finish_time;
+    m->p99_turnaround = percentile(turnarounds, num_processes, 99.0);
+    m->p99_response = percentile(responses, num_processes, 99.0);
+    
+    free(turnarounds);
+    free(responses);
+    return 1;
+}
+
+// Simulate one query on a private copy of the trace. Returns 0 if memory
+// runs out, so the server can reply with an error and keep going.
+int run_query(const QueryKey *key, Metrics *m) {
+    Trace *trace = &traces[key->trace_idx];
+    Thread *sim_threads = malloc(trace->n * sizeof(Thread));
+    Process *processes = malloc(trace->num_processes * sizeof(Process));
+    int ok = 0;
+    
+    if (sim_threads && processes) {
+        memcpy(sim_threads, trace->threads, trace->n * sizeof(Thread));
+        
+        switch (key->policy) {
+            case POLICY_FCFS:
+                ok = simulate_fcfs(sim_threads, trace->n, key->latency);
+                break;
+            case POLICY_RR:
+                ok = simulate_rr(sim_threads, trace->n, key->latency, key->quantum_q1);
+                break;
+            case POLICY_MLFQ:
+                ok = simulate_mlfq(sim_threads, trace->n, key->latency, key->quantum_q1, key->quantum_q2);
+                break;
+        }
+        if (ok) {
+            aggregate_by_pid(sim_threads, trace->n, processes, trace->num_processes);
+            ok = compute_metrics(processes, trace->num_processes, m);
+        }
+    }
+    
+    free(sim_threads);
+    free(processes);
+    return ok;
+}
+
+unsigned int hash_key(const QueryKey *key) {
+    unsigned int h = 2166136261u;
+    int fields[5] = { key->trace_idx, key->policy, key->latency, key->quantum_q1, key->quantum_q2 };
+    
+    for (int i = 0; i < 5; i++) {
+        h = (h ^ (unsigned int)fields[i]) * 16777619u;
+    }
+    return h % CACHE_SIZE;
+}
+
+int same_key(const QueryKey *a, const QueryKey *b) {
+    return a->trace_idx == b->trace_idx && a->policy == b->policy &&
+           a->latency == b->latency && a->quantum_q1 == b->quantum_q1 &&
+           a->quantum_q2 == b->quantum_q2;
+}
+
+// Returns 1 if the answer came from the cache, 0 if it was simulated and -1
+// if the simulation ran out of memory. The lock is not held while
+// simulating, so two workers may race on the same new query; both compute
+// the same result and the second store is harmless.
+int lookup_or_run(const QueryKey *key, Metrics *m) {
+    unsigned int slot = hash_key(key);
+    
+    pthread_mutex_lock(&cache_lock);
+    if (cache[slot].valid && same_key(&cache[slot].key, key)) {
+        *m = cache[slot].metrics;
+        pthread_mutex_unlock(&cache_lock);
+        return 1;
+    }
+    pthread_mutex_unlock(&cache_lock);
+    
+    if (!run_query(key, m)) return -1;
+    
+    pthread_mutex_lock(&cache_lock);
+    cache[slot].valid = 1;
+    cache[slot].key = *key;
+    cache[slot].metrics = *m;
+    pthread_mutex_unlock(&cache_lock);
+    return 0;
+}
+
+int append_metric(char *out, size_t size, const char *name, const Metrics *m) {
+    double value;
+    
+    if (strcmp(name, "throughput") == 0) value = m->throughput;
+    else if (strcmp(name, "avg_wait") == 0) value = m->avg_waiting;
+    else if (strcmp(name, "avg_tat") == 0) value = m->avg_turnaround;
+    else if (strcmp(name, "avg_rt") == 0) value = m->avg_response;
+    else if (strcmp(name, "p99_tat") == 0) value = m->p99_turnaround;
+    else if (strcmp(name, "p99_rt") == 0) value = m->p99_response;
+    else return 0;
+    
+    size_t len = strlen(out);
+    snprintf(out + len, size - len, " %s=%.6f", name, value);
+    return 1;
+}
+
+// Handle one request line and write the reply into out. Requests:
+//   SIM trace=NAME policy=fcfs|rr|mlfq [latency=N] [quantum=N] [q1=N q2=N] [metrics=a,b,...]
+//   TRACES
+void handle_request(char *request, char *out, size_t size) {
+    char *save;
+    char *cmd = strtok_r(request, " \t\r\n", &save);
+    
+    if (cmd == NULL) {
+        snprintf(out, size, "ERR empty request\n");
+        return;
+    }
+    
+    if (strcmp(cmd, "TRACES") == 0) {
+        snprintf(out, size, "OK");
+        for (int i = 0; i < num_traces; i++) {
+            size_t len = strlen(out);
+            snprintf(out + len, size - len, " %s", traces[i].name);
+        }
+        strncat(out, "\n", size - strlen(out) - 1);
+        return;
+    }
+    
+    if (strcmp(cmd, "SIM") != 0) {
+        snprintf(out, size, "ERR unknown command %s\n", cmd);
+        return;
+    }
+    
+    QueryKey key = { -1, POLICY_RR, DEFAULT_LATENCY, -1, -1 };
+    char metrics[MAX_LINE] = "throughput,avg_wait,avg_tat,avg_rt";
+    char *arg;
+    
+    while ((arg = strtok_r(NULL, " \t\r\n", &save)) != NULL) {
+        char *value = strchr(arg, '=');
+        if (value == NULL) {
+            snprintf(out, size, "ERR expected key=value, got %s\n", arg);
+            return;
+        }
+        *value++ = '\0';
+        
+        if (strcmp(arg, "trace") == 0) {
+            key.trace_idx = find_trace(value);
+            if (key.trace_idx == -1) {
+                snprintf(out, size, "ERR unknown trace %s\n", value);
+                return;
+            }
+        } else if (strcmp(arg, "policy") == 0) {
+            if (strcmp(value, "fcfs") == 0) key.policy = POLICY_FCFS;
+            else if (strcmp(value, "rr") == 0) key.policy = POLICY_RR;
+            else if (strcmp(value, "mlfq") == 0) key.policy = POLICY_MLFQ;
+            else {
+                snprintf(out, size, "ERR unknown policy %s\n", value);
+                return;
+            }
+        } else if (strcmp(arg, "latency") == 0) {
+            key.latency = atoi(value);
+        } else if (strcmp(arg, "quantum") == 0 || strcmp(arg, "q1") == 0) {
+            key.quantum_q1 = atoi(value);
+        } else if (strcmp(arg, "q2") == 0) {
+            key.quantum_q2 = atoi(value);
+        } else if (strcmp(arg, "metrics") == 0) {
+            snprintf(metrics, sizeof(metrics), "%s", value);
+        } else {
+            snprintf(out, size, "ERR unknown argument %s\n", arg);
+            return;
+        }
+    }
+    
+    if (key.trace_idx == -1) {
+        if (num_traces != 1) {
+            snprintf(out, size, "ERR trace= is required\n");
+            return;
+        }
+        key.trace_idx = 0;
+    }
+    
+    // Normalize the key so equivalent queries share a cache entry
+    if (key.policy == POLICY_FCFS) {
+        key.quantum_q1 = 0;
+        key.quantum_q2 = 0;
+    } else if (key.policy == POLICY_RR) {
+        if (key.quantum_q1 == -1) {
+            snprintf(out, size, "ERR quantum= is required for rr\n");
+            return;
+        }
+        key.quantum_q2 = 0;
+    } else {
+        if (key.quantum_q1 == -1) key.quantum_q1 = DEFAULT_QUANTUM_Q1;
+        if (key.quantum_q2 == -1) key.quantum_q2 = DEFAULT_QUANTUM_Q2;
+    }
+    
+    if (key.latency < 0 || (key.policy != POLICY_FCFS && (key.quantum_q1 < 1 || key.quantum_q2 < 0 ||
+        (key.policy == POLICY_MLFQ && key.quantum_q2 < 1)))) {
+        snprintf(out, size, "ERR latency must be >= 0 and quanta >= 1\n");
+        return;
+    }
+    
+    Metrics m;
+    int cached = lookup_or_run(&key, &m);
+    if (cached < 0) {
+        snprintf(out, size, "ERR out of memory\n");
+        return;
+    }
+    
+    snprintf(out, size, "OK");
+    char *msave;
+    for (char *name = strtok_r(metrics, ",", &msave); name; name = strtok_r(NULL, ",", &msave)) {
+        if (!append_metric(out, size, name, &m)) {
+            snprintf(out, size, "ERR unknown metric %s\n", name);
+            return;
+        }
+    }
+    size_t len = strlen(out);
+    snprintf(out + len, size - len, " cached=%d\n", cached);
+}
+
+Connection *open_connection(int fd) {
+    Connection *conn = malloc(sizeof(Connection));
+    if (!conn) return NULL;
+    
+    memset(conn, 0, sizeof(Connection));
+    conn->fd = fd;
+    pthread_mutex_init(&conn->lock, NULL);
+    return conn;
+}
+
+void free_connection(Connection *conn) {
+    close(conn->fd);
+    pthread_mutex_destroy(&conn->lock);
+    free(conn);
+}
+
+int has_room(Connection *conn) {
+    pthread_mutex_lock(&conn->lock);
+    int room = conn->in_flight < MAX_PENDING;
+    pthread_mutex_unlock(&conn->lock);
+    return room;
+}
+
+// The client has hung up (or its socket failed) and every reply it is owed
+// has been written or dropped, so no worker can still refer to it
+int finished(Connection *conn) {
+    if (!conn->eof || conn->used > 0) return 0;
+    pthread_mutex_lock(&conn->lock);
+    int idle = conn->in_flight == 0;
+    pthread_mutex_unlock(&conn->lock);
+    return idle;
+}
+
+// A full pipe already guarantees a wakeup, so a failed write is fine
+void wake_poll_loop(void) {
+    ssize_t written = write(wake_pipe[1], "w", 1);
+    (void)written;
+}
+
+// Called by a worker once the reply for request seq is in its slot. The
+// worker never touches the socket; the poll loop writes the reply.
+void complete_request(Connection *conn, unsigned long seq) {
+    pthread_mutex_lock(&conn->lock);
+    conn->ready[seq % MAX_PENDING] = 1;
+    pthread_mutex_unlock(&conn->lock);
+    wake_poll_loop();
+}
+
+// Poll thread: write ready replies in request order until the next one is
+// not ready yet or the socket is full. The socket is non-blocking and the
+// lock is only held to look at the slot flags, never across write(), so a
+// client that stops reading cannot stall the server. Returns 1 if a reply is
+// waiting for the socket to drain (poll for POLLOUT).
+int flush_replies(Connection *conn) {
+    while (1) {
+        pthread_mutex_lock(&conn->lock);
+        int slot = conn->next_reply % MAX_PENDING;
+        int ready = conn->ready[slot];
+        pthread_mutex_unlock(&conn->lock);
+        if (!ready) return 0;
+        
+        // A ready slot is not written by workers again until it is released
+        // below, so it can be read without the lock
+        if (!conn->broken) {
+            size_t len = strlen(conn->replies[slot]);
+            ssize_t written = write(conn->fd, conn->replies[slot] + conn->sent, len - conn->sent);
+            if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 1;
+            if (written < 0) {
+                // Hung up without reading: drop what it is still owed
+                conn->broken = 1;
+                conn->eof = 1;
+                conn->used = 0;
+            } else if ((conn->sent += written) < len) {
+                return 1;
+            }
+        }
+        conn->sent = 0;
+        
+        pthread_mutex_lock(&conn->lock);
+        conn->ready[slot] = 0;
+        conn->next_reply++;
+        conn->in_flight--;
+        pthread_mutex_unlock(&conn->lock);
+    }
+}
+
+void *worker_main(void *arg) {
+    (void)arg;
+    Request request;
+    
+    while (1) {
+        pthread_mutex_lock(&request_queue.lock);
+        while (request_queue.size == 0) {
+            pthread_cond_wait(&request_queue.not_empty, &request_queue.lock);
+        }
+        request = request_queue.requests[request_queue.front];
+        request_queue.front = (request_queue.front + 1) % REQUEST_QUEUE_SIZE;
+        request_queue.size--;
+        pthread_cond_signal(&request_queue.not_full);
+        pthread_mutex_unlock(&request_queue.lock);
+        
+        // The slot belongs to this request until its reply is written, so it
+        // can be filled without holding the connection lock
+        char *reply = request.conn->replies[request.seq % MAX_PENDING];
+        if (request.too_long) {
+            snprintf(reply, REPLY_SIZE, "ERR request longer than %d bytes\n", MAX_LINE - 2);
+        } else {
+            handle_request(request.line, reply, REPLY_SIZE);
+        }
+        complete_request(request.conn, request.seq);
+    }
+    return NULL;
+}
+
+void submit_request(Connection *conn, const char *line, int too_long) {
+    pthread_mutex_lock(&conn->lock);
+    conn->in_flight++;
+    pthread_mutex_unlock(&conn->lock);
+    
+    pthread_mutex_lock(&request_queue.lock);
+    while (request_queue.size == REQUEST_QUEUE_SIZE) {
+        pthread_cond_wait(&request_queue.not_full, &request_queue.lock);
+    }
+    Request *request = &request_queue.requests[(request_queue.front + request_queue.size) % REQUEST_QUEUE_SIZE];
+    request->conn = conn;
+    request->seq = conn->next_seq++;
+    request->too_long = too_long;
+    snprintf(request->line, MAX_LINE, "%s", line);
+    request_queue.size++;
+    pthread_cond_signal(&request_queue.not_empty);
+    pthread_mutex_unlock(&request_queue.lock);
+}
+
+void consume(Connection *conn, int count) {
+    memmove(conn->buffer, conn->buffer + count, conn->used - count);
+    conn->used -= count;
+}
+
+// Queue every complete line in the buffer while the connection has room for
+// more requests in flight. A line that fills the whole buffer without a
+// newline gets one error reply, and the rest of it is skipped.
+void take_lines(Connection *conn) {
+    while (has_room(conn)) {
+        char *newline = memchr(conn->buffer, '\n', conn->used);
+        
+        if (conn->discarding) {
+            if (newline == NULL) {
+                conn->used = 0;
+                return;
+            }
+            conn->discarding = 0;
+            consume(conn, newline + 1 - conn->buffer);
+        } else if (newline != NULL) {
+            *newline = '\0';
+            submit_request(conn, conn->buffer, 0);
+            consume(conn, newline + 1 - conn->buffer);
+        } else if (conn->used == MAX_LINE - 1) {
+            submit_request(conn, "", 1);
+            conn->discarding = 1;
+            conn->used = 0;
+        } else if (conn->eof && conn->used > 0) {
+            // Last request without a trailing newline
+            conn->buffer[conn->used] = '\0';
+            submit_request(conn, conn->buffer, 0);
+            conn->used = 0;
+        } else {
+            return;
+        }
+    }
+}
+
+// The main thread owns every socket. It reads request lines and hands each
+// one to the worker pool, so an idle connection never ties up a worker and
+// the requests of one connection run concurrently.
+void serve(int listen_fd) {
+    Connection *conns[MAX_CONNECTIONS];
+    Connection *polled[MAX_CONNECTIONS + 2];
+    struct pollfd fds[MAX_CONNECTIONS + 2];
+    int num_conns = 0;
+    
+    while (1) {
+        int blocked[MAX_CONNECTIONS];
+        for (int i = 0; i < num_conns; ) {
+            take_lines(conns[i]);
+            blocked[i] = flush_replies(conns[i]);
+            if (finished(conns[i])) {
+                free_connection(conns[i]);
+                conns[i] = conns[--num_conns];
+                continue;
+            }
+            i++;
+        }
+        
+        int nfds = 0;
+        fds[nfds].fd = wake_pipe[0];
+        fds[nfds].events = POLLIN;
+        polled[nfds++] = NULL;
+        if (num_conns < MAX_CONNECTIONS) {
+            fds[nfds].fd = listen_fd;
+            fds[nfds].events = POLLIN;
+            polled[nfds++] = NULL;
+        }
+        for (int i = 0; i < num_conns; i++) {
+            short events = 0;
+            if (!conns[i]->eof && has_room(conns[i])) events |= POLLIN;
+            if (blocked[i]) events |= POLLOUT;
+            if (events == 0) continue;
+            fds[nfds].fd = conns[i]->fd;
+            fds[nfds].events = events;
+            polled[nfds++] = conns[i];
+        }
+        
+        if (poll(fds, nfds, -1) < 0) continue;
+        
+        for (int i = 0; i < nfds; i++) {
+            if (fds[i].revents == 0) continue;
+            
+            if (fds[i].fd == wake_pipe[0]) {
+                char drain[64];
+                while (read(wake_pipe[0], drain, sizeof(drain)) > 0);
+            } else if (fds[i].fd == listen_fd) {
+                int fd = accept(listen_fd, NULL, NULL);
+                if (fd < 0) continue;
+                fcntl(fd, F_SETFL, O_NONBLOCK);
+                Connection *conn = open_connection(fd);
+                if (conn) {
+                    conns[num_conns++] = conn;
+                } else {
+                    close(fd);
+                }
+            } else if (fds[i].events & POLLIN) {
+                // POLLOUT needs nothing here: the next pass flushes replies
+                Connection *conn = polled[i];
+                ssize_t got = read(conn->fd, conn->buffer + conn->used, MAX_LINE - 1 - conn->used);
+                if (got > 0) {
+                    conn->used += got;
+                } else if (got == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) {
+                    conn->eof = 1;
+                }
+            }
+        }
+    }
+}
+
+void handle_shutdown(int sig) {
+    (void)sig;
+    if (socket_path) unlink(socket_path);
+    _exit(0);
+}
+
+int open_socket(const char *path, int listening) {
+    struct sockaddr_un addr;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+    
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "Socket path too long: %s\n", path);
+        close(fd);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+    
+    if (listening) {
+        unlink(path);
+        if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(fd, MAX_CONNECTIONS) < 0) {
+            perror(path);
+            close(fd);
+            return -1;
+        }
+    } else if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        perror(path);
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// Client mode: send each request, print each reply line
+int run_client(const char *path, int count, char *requests[]) {
+    int fd = open_socket(path, 0);
+    if (fd < 0) return 1;
+    
+    FILE *in = fdopen(fd, "r");
+    char reply[1024];
+    
+    for (int i = 0; i < count; i++) {
+        size_t len = strlen(requests[i]);
+        if (write(fd, requests[i], len) != (ssize_t)len || write(fd, "\n", 1) != 1) {
+            perror("write");
+            fclose(in);
+            return 1;
+        }
+        if (fgets(reply, sizeof(reply), in) == NULL) {
+            fprintf(stderr, "Server closed the connection\n");
+            fclose(in);
+            return 1;
+        }
+        fputs(reply, stdout);
+    }
+    
+    fclose(in);
+    return 0;
+}
+
+void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--workers=N] SOCKET NAME=TRACE.csv [NAME=TRACE.csv ...]\n", prog);
+    fprintf(stderr, "       %s --query SOCKET \"REQUEST\" [\"REQUEST\" ...]\n", prog);
+    fprintf(stderr, "  REQUEST: SIM trace=NAME policy=fcfs|rr|mlfq [latency=N] [quantum=N] [q1=N q2=N]\n");
+    fprintf(stderr, "               [metrics=throughput,avg_wait,avg_tat,avg_rt,p99_tat,p99_rt]\n");
+    fprintf(stderr, "           TRACES\n");
+}
+
+int main(int argc, char *argv[]) {
+    int workers = DEFAULT_WORKERS;
+    int argi = 1;
+    
+    if (argc >= 3 && strcmp(argv[1], "--query") == 0) {
+        return run_client(argv[2], argc - 3, argv + 3);
+    }
+    
+    if (argi < argc && strncmp(argv[argi], "--workers=", 10) == 0) {
+        workers = atoi(argv[argi] + 10);
+        argi++;
+    }
+    
+    if (argc - argi < 2 || workers < 1) {
+        print_usage(argv[0]);
+        return 1;
+    }
+    
+    socket_path = argv[argi++];
+    
+    // Load every trace up front; queries only ever read them
+    for (; argi < argc; argi++) {
+        char *eq = strchr(argv[argi], '=');
+        if (eq == NULL) {
+            print_usage(argv[0]);
+            return 1;
+        }
+        *eq = '\0';
+        if (!load_trace(argv[argi], eq + 1)) return 1;
+    }
+    
+    int listen_fd = open_socket(socket_path, 1);
+    if (listen_fd < 0) return 1;
+    
+    if (pipe(wake_pipe) < 0) {
+        perror("pipe");
+        return 1;
+    }
+    fcntl(wake_pipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(wake_pipe[1], F_SETFL, O_NONBLOCK);
+    
+    signal(SIGPIPE, SIG_IGN);
+    signal(SIGINT, handle_shutdown);
+    signal(SIGTERM, handle_shutdown);
+    
+    for (int i = 0; i < workers; i++) {
+        pthread_t tid;
+        if (pthread_create(&tid, NULL, worker_main, NULL) != 0) {
+            fprintf(stderr, "Error creating worker thread\n");
+            return 1;
+        }
+        pthread_detach(tid);
+    }
+    
+    printf("Listening on %s with %d workers\n", socket_path, workers);
+    fflush(stdout);
+    
+    serve(listen_fd);
+    return 0;
+}
@@ -0,0 +1,499 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_LINE 256
+#define DEFAULT_MEMORY_MB 64
+#define MAX_FAN_IN 256
+#define MAX_BUFFER_ROWS (1 << 28)
+#define OUTPUT_BUFFER (1 << 20)
+#define DEFAULT_HEADER "Pid,Arrival Time,Time until first Response,Burst Length\n"
+
+typedef struct {
+    int pid;
+    int arrival_time;
+    int time_until_first_response;
+    int burst_length;
+} Row;
+
+// A sorted stream of rows: either an input file that was already in arrival
+// order (merged straight from disk, never copied) or a sorted chunk that was
+// spilled to a scratch file as raw Rows
+typedef struct {
+    const char *path;       // sorted CSV input, NULL for spilled runs
+    FILE *fp;
+    FILE *spill;
+    long long offset;       // next row of the spilled segment
+    long long end;
+    Row *buffer;
+    int buffered;
+    int pos;
+    Row current;
+} Run;
+
+typedef struct {
+    Run *runs;
+    int count;
+    int capacity;
+} RunList;
+
+typedef struct {
+    size_t memory;
+    const char *tmpdir;
+    char header[MAX_LINE];
+    int have_header;
+    long long rows;
+    int sorted_inputs;
+    int spilled_runs;
+    int merge_passes;
+} Sorter;
+
+int parse_line(char *line, Row *r) {
+    char *token;
+    int field = 0;
+    
+    token = strtok(line, ",");
+    while (token != NULL && field < 4) {
+        switch(field) {
+            case 0: r->pid = atoi(token); break;
+            case 1: r->arrival_time = atoi(token); break;
+            case 2: r->time_until_first_response = atoi(token); break;
+            case 3: r->burst_length = atoi(token); break;
+        }
+        token = strtok(NULL, ",");
+        field++;
+    }
+    return field == 4;
+}
+
+int read_csv_row(FILE *fp, Row *r) {
+    char line[MAX_LINE];
+    while (fgets(line, MAX_LINE, fp) != NULL) {
+        if (parse_line(line, r)) return 1;
+    }
+    return 0;
+}
+
+// Keep the first input's header so the output reads like any other trace
+int read_header(Sorter *s, FILE *fp, const char *path) {
+    char line[MAX_LINE];
+    if (fgets(line, MAX_LINE, fp) == NULL) {
+        fprintf(stderr, "Error reading header of %s\n", path);
+        return 0;
+    }
+    if (!s->have_header) {
+        snprintf(s->header, MAX_LINE, "%s", line);
+        s->have_header = 1;
+    }
+    return 1;
+}
+
+// Scratch file in --tmpdir, unlinked at once so it disappears on exit
+FILE *open_spill(const char *dir) {
+    char path[MAX_LINE];
+    snprintf(path, MAX_LINE, "%s/a2sort.XXXXXX", dir);
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        perror(path);
+        return NULL;
+    }
+    unlink(path);
+    return fdopen(fd, "w+");
+}
+
+int add_run(RunList *list, Run run) {
+    if (list->count == list->capacity) {
+        int capacity = list->capacity ? list->capacity * 2 : 16;
+        Run *grown = realloc(list->runs, capacity * sizeof(Run));
+        if (!grown) {
+            fprintf(stderr, "Out of memory for %d runs\n", capacity);
+            return 0;
+        }
+        list->runs = grown;
+        list->capacity = capacity;
+    }
+    list->runs[list->count++] = run;
+    return 1;
+}
+
+// Rows that fit in bytes of memory, computed in size_t so a large --memory
+// cannot overflow, and clamped so row indices (and the merge sort's doubling
+// widths) stay well inside int
+int rows_for(size_t bytes) {
+    size_t rows = bytes / sizeof(Row);
+    if (rows > MAX_BUFFER_ROWS) return MAX_BUFFER_ROWS;
+    return (rows < 1) ? 1 : (int)rows;
+}
+
+// Stable bottom-up merge sort by arrival time
+void sort_rows(Row rows[], Row tmp[], int n) {
+    Row *src = rows, *dst = tmp;
+    for (int width = 1; width < n; width *= 2) {
+        for (int lo = 0; lo < n; lo += 2 * width) {
+            int mid = (lo + width < n) ? lo + width : n;
+            int hi = (lo + 2 * width < n) ? lo + 2 * width : n;
+            int i = lo, j = mid, k = lo;
+            while (i < mid && j < hi) {
+                dst[k++] = (src[j].arrival_time < src[i].arrival_time) ? src[j++] : src[i++];
+            }
+            while (i < mid) dst[k++] = src[i++];
+            while (j < hi) dst[k++] = src[j++];
+        }
+        Row *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != rows) memcpy(rows, src, n * sizeof(Row));
+}
+
+// One streaming pass: count rows and rows that arrive before the row above
+int check_sorted(const char *path, long long *rows, long long *out_of_order) {
+    FILE *fp = fopen(path, "r");
+    char line[MAX_LINE];
+    Row r;
+    int prev = 0;
+    
+    if (!fp) {
+        fprintf(stderr, "Error opening %s\n", path);
+        return 0;
+    }
+    *rows = 0;
+    *out_of_order = 0;
+    if (fgets(line, MAX_LINE, fp) != NULL) {
+        while (read_csv_row(fp, &r)) {
+            if (*rows > 0 && r.arrival_time < prev) (*out_of_order)++;
+            prev = r.arrival_time;
+            (*rows)++;
+        }
+    }
+    fclose(fp);
+    return 1;
+}
+
+// Read an unsorted input in memory-sized chunks, sort each chunk and append
+// it to the spill file as one run
+int spill_input(Sorter *s, FILE *fp, FILE *spill, RunList *list) {
+    int chunk_rows = rows_for(s->memory / 2);
+    Row *rows = malloc((size_t)chunk_rows * sizeof(Row));
+    Row *tmp = malloc((size_t)chunk_rows * sizeof(Row));
+    int n;
+    
+    if (!rows || !tmp) {
+        fprintf(stderr, "Out of memory for %d-row sort chunks (try a smaller --memory)\n", chunk_rows);
+        free(rows);
+        free(tmp);
+        return 0;
+    }
+    
+    do {
+        n = 0;
+        while (n < chunk_rows && read_csv_row(fp, &rows[n])) n++;
+        if (n == 0) break;
+        
+        sort_rows(rows, tmp, n);
+        
+        Run run;
+        memset(&run, 0, sizeof(run));
+        run.spill = spill;
+        run.offset = ftello(spill) / sizeof(Row);
+        run.end = run.offset + n;
+        if (fwrite(rows, sizeof(Row), n, spill) != (size_t)n) {
+            perror("spill");
+            free(rows);
+            free(tmp);
+            return 0;
+        }
+        if (!add_run(list, run)) {
+            free(rows);
+            free(tmp);
+            return 0;
+        }
+        s->rows += n;
+        s->spilled_runs++;
+    } while (n == chunk_rows);
+    
+    free(rows);
+    free(tmp);
+    return 1;
+}
+
+int add_input(Sorter *s, const char *path, FILE *spill, RunList *list) {
+    // stdin can only be read once, so it always goes through the spill file
+    if (strcmp(path, "-") == 0) {
+        if (!read_header(s, stdin, "stdin")) return 0;
+        fprintf(stderr, "stdin: sorting in chunks\n");
+        return spill_input(s, stdin, spill, list);
+    }
+    
+    long long rows, out_of_order;
+    if (!check_sorted(path, &rows, &out_of_order)) return 0;
+    
+    FILE *fp = fopen(path, "r");
+    if (!fp) {
+        fprintf(stderr, "Error opening %s\n", path);
+        return 0;
+    }
+    if (!read_header(s, fp, path)) {
+        fclose(fp);
+        return 0;
+    }
+    
+    if (out_of_order == 0) {
+        // Already in arrival order: merge it straight from the file
+        fclose(fp);
+        Run run;
+        memset(&run, 0, sizeof(run));
+        run.path = path;
+        if (!add_run(list, run)) return 0;
+        s->rows += rows;
+        s->sorted_inputs++;
+        fprintf(stderr, "%s: %lld rows, sorted\n", path, rows);
+        return 1;
+    }
+    
+    fprintf(stderr, "%s: %lld rows, %lld out of order, sorting in chunks\n", path, rows, out_of_order);
+    int ok = spill_input(s, fp, spill, list);
+    fclose(fp);
+    return ok;
+}
+
+int open_run(Run *run, int buffer_rows) {
+    if (run->path) {
+        char line[MAX_LINE];
+        run->fp = fopen(run->path, "r");
+        if (!run->fp || fgets(line, MAX_LINE, run->fp) == NULL) {
+            fprintf(stderr, "Error reopening %s\n", run->path);
+            return 0;
+        }
+    } else {
+        run->buffer = malloc((size_t)buffer_rows * sizeof(Row));
+        if (!run->buffer) {
+            fprintf(stderr, "Out of memory for %d-row merge buffers (try a smaller --memory)\n", buffer_rows);
+            return 0;
+        }
+        run->buffered = 0;
+        run->pos = 0;
+    }
+    return 1;
+}
+
+void close_run(Run *run) {
+    if (run->fp) fclose(run->fp);
+    free(run->buffer);
+    run->fp = NULL;
+    run->buffer = NULL;
+}
+
+// Advance run->current; 0 at the end of the run
+int next_row(Run *run, int buffer_rows) {
+    if (run->path) return read_csv_row(run->fp, &run->current);
+    
+    if (run->pos == run->buffered) {
+        long long left = run->end - run->offset;
+        if (left == 0) return 0;
+        int want = (left < buffer_rows) ? (int)left : buffer_rows;
+        ssize_t got = pread(fileno(run->spill), run->buffer, want * sizeof(Row), run->offset * sizeof(Row));
+        if (got != (ssize_t)(want * sizeof(Row))) {
+            perror("spill");
+            exit(1);
+        }
+        run->offset += want;
+        run->buffered = want;
+        run->pos = 0;
+    }
+    run->current = run->buffer[run->pos++];
+    return 1;
+}
+
+// Min-heap of run indices by (arrival, run index). Runs are numbered in input
+// order, so rows with equal arrival times keep their input order.
+int run_before(const Run runs[], int a, int b) {
+    if (runs[a].current.arrival_time != runs[b].current.arrival_time) {
+        return runs[a].current.arrival_time < runs[b].current.arrival_time;
+    }
+    return a < b;
+}
+
+void sift_down(int heap[], int size, const Run runs[], int i) {
+    while (2 * i + 1 < size) {
+        int child = 2 * i + 1;
+        if (child + 1 < size && run_before(runs, heap[child + 1], heap[child])) child++;
+        if (!run_before(runs, heap[child], heap[i])) break;
+        int t = heap[i];
+        heap[i] = heap[child];
+        heap[child] = t;
+        i = child;
+    }
+}
+
+// k-way merge of runs[first..first+count) into a CSV stream (out_csv) or into
+// a new spilled run appended to out_spill
+int merge_runs(Sorter *s, Run runs[], int first, int count, FILE *out_csv, FILE *out_spill, Run *merged) {
+    int buffer_rows = rows_for(s->memory / (count + 1));
+    int *heap = malloc(count * sizeof(int));
+    Row *out_buffer = NULL;
+    int out_count = 0;
+    int size = 0;
+    
+    if (!heap) {
+        fprintf(stderr, "Out of memory merging %d runs\n", count);
+        return 0;
+    }
+    
+    for (int i = first; i < first + count; i++) {
+        if (!open_run(&runs[i], buffer_rows)) return 0;
+        if (next_row(&runs[i], buffer_rows)) heap[size++] = i;
+    }
+    for (int i = size / 2 - 1; i >= 0; i--) sift_down(heap, size, runs, i);
+    
+    if (out_spill) {
+        memset(merged, 0, sizeof(*merged));
+        merged->spill = out_spill;
+        merged->offset = ftello(out_spill) / sizeof(Row);
+        out_buffer = malloc((size_t)buffer_rows * sizeof(Row));
+        if (!out_buffer) {
+            fprintf(stderr, "Out of memory for %d-row merge buffers (try a smaller --memory)\n", buffer_rows);
+            return 0;
+        }
+    }
+    
+    long long written = 0;
+    while (size > 0) {
+        Run *top = &runs[heap[0]];
+        if (out_csv) {
+            fprintf(out_csv, "%d,%d,%d,%d\n", top->current.pid, top->current.arrival_time,
+                    top->current.time_until_first_response, top->current.burst_length);
+        } else {
+            out_buffer[out_count++] = top->current;
+            if (out_count == buffer_rows) {
+                if (fwrite(out_buffer, sizeof(Row), out_count, out_spill) != (size_t)out_count) {
+                    perror("spill");
+                    return 0;
+                }
+                out_count = 0;
+            }
+        }
+        written++;
+        
+        if (!next_row(top, buffer_rows)) heap[0] = heap[--size];
+        sift_down(heap, size, runs, 0);
+    }
+    
+    if (out_spill) {
+        if (fwrite(out_buffer, sizeof(Row), out_count, out_spill) != (size_t)out_count) {
+            perror("spill");
+            return 0;
+        }
+        merged->end = merged->offset + written;
+        free(out_buffer);
+    }
+    
+    for (int i = first; i < first + count; i++) close_run(&runs[i]);
+    free(heap);
+    return 1;
+}
+
+// Merge groups of MAX_FAN_IN runs into a fresh spill file until one final
+// merge can take them all, keeping open files and buffers bounded
+int reduce_runs(Sorter *s, RunList *list, FILE **spill) {
+    while (list->count > MAX_FAN_IN) {
+        FILE *next_spill = open_spill(s->tmpdir);
+        RunList next;
+        memset(&next, 0, sizeof(next));
+        if (!next_spill) return 0;
+        
+        fflush(*spill);
+        for (int first = 0; first < list->count; first += MAX_FAN_IN) {
+            int count = (list->count - first < MAX_FAN_IN) ? list->count - first : MAX_FAN_IN;
+            Run merged;
+            if (!merge_runs(s, list->runs, first, count, NULL, next_spill, &merged)) return 0;
+            if (!add_run(&next, merged)) return 0;
+        }
+        
+        fclose(*spill);
+        free(list->runs);
+        *spill = next_spill;
+        *list = next;
+        s->merge_passes++;
+    }
+    return 1;
+}
+
+void print_usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [--memory=MB] [--tmpdir=DIR] [--check] [TRACE.csv|-]... > sorted.csv\n", prog);
+    fprintf(stderr, "  Merges the traces into one stream ordered by arrival time (stdin if none given)\n");
+}
+
+int main(int argc, char *argv[]) {
+    Sorter s;
+    int check_only = 0;
+    int num_inputs = 0;
+    const char **inputs = malloc((argc + 1) * sizeof(char *));
+    
+    memset(&s, 0, sizeof(s));
+    s.memory = (size_t)DEFAULT_MEMORY_MB << 20;
+    s.tmpdir = getenv("TMPDIR") ? getenv("TMPDIR") : "/tmp";
+    
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "--memory=", 9) == 0) {
+            int mb = atoi(argv[i] + 9);
+            if (mb < 1) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            s.memory = (size_t)mb << 20;
+        } else if (strncmp(argv[i], "--tmpdir=", 9) == 0) {
+            s.tmpdir = argv[i] + 9;
+        } else if (strcmp(argv[i], "--check") == 0) {
+            check_only = 1;
+        } else if (strncmp(argv[i], "--", 2) == 0) {
+            print_usage(argv[0]);
+            return 1;
+        } else {
+            inputs[num_inputs++] = argv[i];
+        }
+    }
+    if (num_inputs == 0) inputs[num_inputs++] = "-";
+    
+    // --check: report each file's order and exit non-zero if any is unsorted
+    if (check_only) {
+        int all_sorted = 1;
+        for (int i = 0; i < num_inputs; i++) {
+            long long rows, out_of_order;
+            if (strcmp(inputs[i], "-") == 0 || !check_sorted(inputs[i], &rows, &out_of_order)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            printf("%s: %lld rows, %lld out of order\n", inputs[i], rows, out_of_order);
+            if (out_of_order > 0) all_sorted = 0;
+        }
+        return all_sorted ? 0 : 1;
+    }
+    
+    FILE *spill = open_spill(s.tmpdir);
+    RunList list;
+    memset(&list, 0, sizeof(list));
+    if (!spill) return 1;
+    
+    for (int i = 0; i < num_inputs; i++) {
+        if (!add_input(&s, inputs[i], spill, &list)) return 1;
+    }
+    
+    if (!reduce_runs(&s, &list, &spill)) return 1;
+    fflush(spill);
+    
+    setvbuf(stdout, NULL, _IOFBF, OUTPUT_BUFFER);
+    fputs(s.have_header ? s.header : DEFAULT_HEADER, stdout);
+    if (!merge_runs(&s, list.runs, 0, list.count, stdout, NULL, NULL)) return 1;
+    fflush(stdout);
+    
+    fprintf(stderr, "Merged %lld rows from %d inputs (%d already sorted, %d spilled runs, %d extra merge passes)\n",
+            s.rows, num_inputs, s.sorted_inputs, s.spilled_runs, s.merge_passes);
+    
+    fclose(spill);
+    free(list.runs);
+    free(inputs);
+    return 0;
+}
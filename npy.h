@@ -0,0 +1,105 @@
+#ifndef NPY_H
+#define NPY_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define DETAIL_COLUMNS 8
+
+// NumPy .npy output shared by a2p1-a2p4. Each file holds one 2-D array
+// stored column-major (fortran_order), so every column is contiguous on disk
+// and np.load(path, mmap_mode='r')[:, j] touches only that column. Rows are
+// placed by offset, so a sweep can fill in its block of every column without
+// buffering the whole table. Include after stats.h and the program's Process
+// typedef.
+typedef struct {
+    FILE *fp;
+    long long rows;
+    int cols;
+    int elem_size;
+    long data_offset;
+} NpyFile;
+
+static inline NpyFile *npy_open(const char *path, const char *descr, int elem_size, long long rows, int cols) {
+    NpyFile *npy = malloc(sizeof(NpyFile));
+    char header[256];
+    
+    if (!npy) {
+        fprintf(stderr, "Out of memory opening %s\n", path);
+        return NULL;
+    }
+    npy->fp = fopen(path, "w");
+    if (!npy->fp) {
+        fprintf(stderr, "Error opening %s\n", path);
+        free(npy);
+        return NULL;
+    }
+    npy->rows = rows;
+    npy->cols = cols;
+    npy->elem_size = elem_size;
+    
+    // Version 1.0 header, padded with spaces so the data starts 64-byte aligned
+    int len = snprintf(header, sizeof(header), "{'descr': '%s', 'fortran_order': True, 'shape': (%lld, %d), }",
+                       descr, rows, cols);
+    int total = 10 + len + 1;
+    int padded = (total + 63) / 64 * 64;
+    while (len < padded - 10 - 1) header[len++] = ' ';
+    header[len++] = '\n';
+    
+    fwrite("\x93NUMPY\x01\x00", 1, 8, npy->fp);
+    fputc(len & 0xff, npy->fp);
+    fputc(len >> 8, npy->fp);
+    fwrite(header, 1, len, npy->fp);
+    npy->data_offset = 10 + len;
+    return npy;
+}
+
+// Store count values of column col starting at first_row
+static inline void npy_write_column(NpyFile *npy, int col, long long first_row, const void *values, int count) {
+    fseek(npy->fp, npy->data_offset + (col * npy->rows + first_row) * npy->elem_size, SEEK_SET);
+    fwrite(values, npy->elem_size, count, npy->fp);
+}
+
+static inline void npy_close(NpyFile *npy) {
+    fclose(npy->fp);
+    free(npy);
+}
+
+static inline void write_summary_row(NpyFile *npy, long long row, const double values[]) {
+    for (int c = 0; c < npy->cols; c++) {
+        npy_write_column(npy, c, row, &values[c], 1);
+    }
+}
+
+// Same columns as the details CSV, one block of num_processes rows per sweep
+// point
+static inline void write_detail_columns(NpyFile *npy, int sweep_idx, int sweep_value, Process processes[], int num_processes) {
+    int *column = malloc(num_processes * sizeof(int));
+    long long first_row = (long long)sweep_idx * num_processes;
+    
+    if (!column) {
+        fprintf(stderr, "Out of memory writing .npy details\n");
+        exit(1);
+    }
+    
+    STAT_START(PHASE_WRITE);
+    for (int c = 0; c < DETAIL_COLUMNS; c++) {
+        for (int i = 0; i < num_processes; i++) {
+            switch (c) {
+                case 0: column[i] = sweep_value; break;
+                case 1: column[i] = processes[i].pid; break;
+                case 2: column[i] = processes[i].earliest_arrival; break;
+                case 3: column[i] = processes[i].first_start; break;
+                case 4: column[i] = processes[i].latest_finish; break;
+                case 5: column[i] = processes[i].turnaround_time; break;
+                case 6: column[i] = processes[i].waiting_time; break;
+                case 7: column[i] = processes[i].response_time; break;
+            }
+        }
+        npy_write_column(npy, c, first_row, column, num_processes);
+    }
+    STAT_STOP(PHASE_WRITE);
+    free(column);
+}
+
+#endif
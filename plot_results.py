@@ -1,157 +1,326 @@
-import pandas as pd
-import matplotlib.pyplot as plt
+import os
+import sys
+
 import numpy as np
+import matplotlib
+if '--show' not in sys.argv:
+    matplotlib.use('Agg')
+import matplotlib.pyplot as plt
+
+# Column order of the .npy files written by the simulators (same as the CSVs)
+SUMMARY_COLUMNS = ['Sweep', 'Throughput', 'Avg_Waiting_Time', 'Avg_Turnaround_Time',
+                   'Avg_Response_Time', 'P99_Turnaround_Time', 'P99_Response_Time']
+DETAIL_COLUMNS = ['Sweep', 'Pid', 'Arrival_Time', 'Start_Time', 'Finish_Time',
+                  'Turnaround_Time', 'Waiting_Time', 'Response_Time']
+MLFQ_COLUMNS = ['Quantum_Q1', 'Quantum_Q2', 'Throughput', 'Avg_Waiting_Time', 'Avg_Turnaround_Time',
+                'Avg_Response_Time', 'P99_Turnaround_Time', 'P99_Response_Time']
+
+# Longest series drawn as-is; longer sweeps are reduced to per-bucket min/max
+MAX_POINTS = 2000
+
+# Percentile band drawn around the per-process metrics
+BAND = (10, 90)
+
+# Dispatcher latency used by the RR/MLFQ/fair-share sweeps
+LATENCY = 20
+
+FORCE = '--force' in sys.argv
+SHOW = '--show' in sys.argv
+
+
+def load_summary(prefix):
+    """Summary table as a dict of columns, memory-mapped from PREFIX_results.npy.
+    Falls back to the CSV when the binary file is missing."""
+    path = prefix + '_results.npy'
+    if os.path.exists(path):
+        table = np.load(path, mmap_mode='r')
+        return {name: table[:, i] for i, name in enumerate(SUMMARY_COLUMNS[:table.shape[1]])}
+    path = prefix + '_results.csv'
+    if not os.path.exists(path):
+        return None
+    table = np.loadtxt(path, delimiter=',', skiprows=1, ndmin=2)
+    return {name: table[:, i] for i, name in enumerate(SUMMARY_COLUMNS[:table.shape[1]])}
+
+
+def load_bands(prefix, metric):
+    """Per-sweep-point percentiles of one per-process metric, or None.
+    The details file holds one block of rows per sweep point, so a column
+    reshapes to (sweep points, processes) without reading any other column."""
+    path = prefix + '_results_details.npy'
+    if not os.path.exists(path):
+        return None
+    details = np.load(path, mmap_mode='r')
+    sweep = details[:, DETAIL_COLUMNS.index('Sweep')]
+    changes = np.flatnonzero(sweep != sweep[0])
+    processes = changes[0] if len(changes) > 0 else len(sweep)
+    values = details[:, DETAIL_COLUMNS.index(metric)].reshape(-1, processes)
+    return np.percentile(values, BAND, axis=1)
+
+
+def buckets(n):
+    """(start, end) index ranges splitting n points into MAX_POINTS // 2 buckets"""
+    edges = np.linspace(0, n, MAX_POINTS // 2 + 1).astype(int)
+    return [(lo, hi) for lo, hi in zip(edges[:-1], edges[1:]) if hi > lo]
+
+
+def downsample(x, y):
+    """Keep the min and max of each bucket so spikes survive decimation"""
+    x = np.asarray(x)
+    y = np.asarray(y)
+    if len(x) <= MAX_POINTS:
+        return x, y
+    keep = []
+    for lo, hi in buckets(len(x)):
+        segment = y[lo:hi]
+        keep.extend(sorted({lo + int(np.argmin(segment)), lo + int(np.argmax(segment))}))
+    keep = np.array(keep)
+    return x[keep], y[keep]
+
+
+def downsample_band(x, low, high):
+    """Envelope of a band over the same buckets as downsample(): each bucket
+    spans its first to last x, at the lowest low and the highest high inside
+    it, so both edges share one x array and the band never gets narrower"""
+    x = np.asarray(x)
+    low = np.asarray(low)
+    high = np.asarray(high)
+    if len(x) <= MAX_POINTS:
+        return x, low, high
+    band_x, band_low, band_high = [], [], []
+    for lo, hi in buckets(len(x)):
+        floor = low[lo:hi].min()
+        ceiling = high[lo:hi].max()
+        band_x.extend([x[lo], x[hi - 1]])
+        band_low.extend([floor, floor])
+        band_high.extend([ceiling, ceiling])
+    return np.array(band_x), np.array(band_low), np.array(band_high)
+
+
+def draw_band(ax, x, bands, color, alpha, label=None):
+    """Shade the p10-p90 band from load_bands()"""
+    band_x, low, high = downsample_band(x, bands[0], bands[1])
+    ax.fill_between(band_x, low, high, color=color, alpha=alpha, label=label)
+
+
+def up_to_date(output, inputs):
+    """True when OUTPUT is newer than every input that exists"""
+    if FORCE or not os.path.exists(output):
+        return False
+    stamp = os.path.getmtime(output)
+    return all(os.path.getmtime(p) <= stamp for p in inputs if os.path.exists(p))
+
+
+def inputs_of(prefix):
+    return [prefix + '_results.npy', prefix + '_results_details.npy', prefix + '_results.csv']
+
+
+def save(fig, output, label):
+    fig.tight_layout()
+    fig.savefig(output, dpi=300, bbox_inches='tight')
+    print(f"{label} saved as {output}")
+    if SHOW:
+        plt.show()
+    plt.close(fig)
+
+
+def plot_sweep_results(prefix, title, xlabel, xshort, output, label):
+    """2x2 figure of throughput, waiting, turnaround and response time vs the
+    sweep variable, with the per-process percentile band shaded"""
+    if up_to_date(output, inputs_of(prefix)):
+        print(f"{output} is up to date")
+        return
+    df = load_summary(prefix)
+    if df is None:
+        print(f"No {prefix} results, skipping {output}")
+        return
 
-def plot_fcfs_results():
-    """Plot FCFS results with latency vs metrics"""
-    # Read the results
-    df = pd.read_csv('fcfs_results.csv')
-    
     # Create figure with 4 subplots
     fig, axes = plt.subplots(2, 2, figsize=(14, 10))
-    fig.suptitle('FCFS Scheduling: Impact of Scheduler/Dispatcher Latency', fontsize=16, fontweight='bold')
-    
-    # Plot 1: Throughput
-    axes[0, 0].plot(df['Scheduler_Latency'], df['Throughput'], 'b-', linewidth=2, label='Throughput')
-    axes[0, 0].set_xlabel('Scheduler/Dispatcher Latency (time units)', fontsize=11)
-    axes[0, 0].set_ylabel('Throughput (processes/time unit)', fontsize=11)
-    axes[0, 0].set_title('Throughput vs Latency', fontsize=12, fontweight='bold')
-    axes[0, 0].grid(True, alpha=0.3)
-    axes[0, 0].legend()
-    
-    # Plot 2: Average Waiting Time
-    axes[0, 1].plot(df['Scheduler_Latency'], df['Avg_Waiting_Time'], 'r-', linewidth=2, label='Avg Waiting Time')
-    axes[0, 1].set_xlabel('Scheduler/Dispatcher Latency (time units)', fontsize=11)
-    axes[0, 1].set_ylabel('Average Waiting Time (time units)', fontsize=11)
-    axes[0, 1].set_title('Average Waiting Time vs Latency', fontsize=12, fontweight='bold')
-    axes[0, 1].grid(True, alpha=0.3)
-    axes[0, 1].legend()
-    
-    # Plot 3: Average Turnaround Time
-    axes[1, 0].plot(df['Scheduler_Latency'], df['Avg_Turnaround_Time'], 'g-', linewidth=2, label='Avg Turnaround Time')
-    axes[1, 0].set_xlabel('Scheduler/Dispatcher Latency (time units)', fontsize=11)
-    axes[1, 0].set_ylabel('Average Turnaround Time (time units)', fontsize=11)
-    axes[1, 0].set_title('Average Turnaround Time vs Latency', fontsize=12, fontweight='bold')
-    axes[1, 0].grid(True, alpha=0.3)
-    axes[1, 0].legend()
-    
-    # Plot 4: Average Response Time
-    axes[1, 1].plot(df['Scheduler_Latency'], df['Avg_Response_Time'], 'm-', linewidth=2, label='Avg Response Time')
-    axes[1, 1].set_xlabel('Scheduler/Dispatcher Latency (time units)', fontsize=11)
-    axes[1, 1].set_ylabel('Average Response Time (time units)', fontsize=11)
-    axes[1, 1].set_title('Average Response Time vs Latency', fontsize=12, fontweight='bold')
-    axes[1, 1].grid(True, alpha=0.3)
-    axes[1, 1].legend()
-    
-    plt.tight_layout()
-    plt.savefig('fcfs_plot.png', dpi=300, bbox_inches='tight')
-    print("FCFS plot saved as fcfs_plot.png")
-    plt.show()
+    fig.suptitle(title, fontsize=16, fontweight='bold')
+
+    panels = [
+        (axes[0, 0], 'Throughput', None, 'b-', 'Throughput', 'Throughput (processes/time unit)'),
+        (axes[0, 1], 'Avg_Waiting_Time', 'Waiting_Time', 'r-', 'Avg Waiting Time', 'Average Waiting Time (time units)'),
+        (axes[1, 0], 'Avg_Turnaround_Time', 'Turnaround_Time', 'g-', 'Avg Turnaround Time', 'Average Turnaround Time (time units)'),
+        (axes[1, 1], 'Avg_Response_Time', 'Response_Time', 'm-', 'Avg Response Time', 'Average Response Time (time units)'),
+    ]
+    for ax, column, detail, style, name, ylabel in panels:
+        x, y = downsample(df['Sweep'], df[column])
+        ax.plot(x, y, style, linewidth=2, label=name)
+
+        # Spread across processes at each sweep point
+        bands = load_bands(prefix, detail) if detail else None
+        if bands is not None:
+            draw_band(ax, df['Sweep'], bands, style[0], 0.15, f'p{BAND[0]}-p{BAND[1]} across processes')
+
+        ax.set_xlabel(xlabel, fontsize=11)
+        ax.set_ylabel(ylabel, fontsize=11)
+        ax.set_title(f'{name.replace("Avg ", "Average ")} vs {xshort}', fontsize=12, fontweight='bold')
+        ax.grid(True, alpha=0.3)
+        ax.legend()
+
+    save(fig, output, label)
+
+
+def plot_fcfs_results():
+    """Plot FCFS results with latency vs metrics"""
+    plot_sweep_results('fcfs', 'FCFS Scheduling: Impact of Scheduler/Dispatcher Latency',
+                       'Scheduler/Dispatcher Latency (time units)', 'Latency',
+                       'fcfs_plot.png', 'FCFS plot')
+
 
 def plot_rr_results():
     """Plot Round Robin results with quantum size vs metrics"""
-    # Read the results
-    df = pd.read_csv('rr_results.csv')
-    
-    # Create figure with 4 subplots
-    fig, axes = plt.subplots(2, 2, figsize=(14, 10))
-    fig.suptitle('Round Robin Scheduling: Impact of Quantum Size', fontsize=16, fontweight='bold')
-    
-    # Plot 1: Throughput
-    axes[0, 0].plot(df['Quantum_Size'], df['Throughput'], 'b-', linewidth=2, label='Throughput')
-    axes[0, 0].set_xlabel('Quantum Size (time units)', fontsize=11)
-    axes[0, 0].set_ylabel('Throughput (processes/time unit)', fontsize=11)
-    axes[0, 0].set_title('Throughput vs Quantum Size', fontsize=12, fontweight='bold')
-    axes[0, 0].grid(True, alpha=0.3)
-    axes[0, 0].legend()
-    
-    # Plot 2: Average Waiting Time
-    axes[0, 1].plot(df['Quantum_Size'], df['Avg_Waiting_Time'], 'r-', linewidth=2, label='Avg Waiting Time')
-    axes[0, 1].set_xlabel('Quantum Size (time units)', fontsize=11)
-    axes[0, 1].set_ylabel('Average Waiting Time (time units)', fontsize=11)
-    axes[0, 1].set_title('Average Waiting Time vs Quantum Size', fontsize=12, fontweight='bold')
-    axes[0, 1].grid(True, alpha=0.3)
-    axes[0, 1].legend()
-    
-    # Plot 3: Average Turnaround Time
-    axes[1, 0].plot(df['Quantum_Size'], df['Avg_Turnaround_Time'], 'g-', linewidth=2, label='Avg Turnaround Time')
-    axes[1, 0].set_xlabel('Quantum Size (time units)', fontsize=11)
-    axes[1, 0].set_ylabel('Average Turnaround Time (time units)', fontsize=11)
-    axes[1, 0].set_title('Average Turnaround Time vs Quantum Size', fontsize=12, fontweight='bold')
-    axes[1, 0].grid(True, alpha=0.3)
-    axes[1, 0].legend()
-    
-    # Plot 4: Average Response Time
-    axes[1, 1].plot(df['Quantum_Size'], df['Avg_Response_Time'], 'm-', linewidth=2, label='Avg Response Time')
-    axes[1, 1].set_xlabel('Quantum Size (time units)', fontsize=11)
-    axes[1, 1].set_ylabel('Average Response Time (time units)', fontsize=11)
-    axes[1, 1].set_title('Average Response Time vs Quantum Size', fontsize=12, fontweight='bold')
-    axes[1, 1].grid(True, alpha=0.3)
-    axes[1, 1].legend()
-    
-    plt.tight_layout()
-    plt.savefig('rr_plot.png', dpi=300, bbox_inches='tight')
-    print("Round Robin plot saved as rr_plot.png")
-    plt.show()
+    plot_sweep_results('rr', 'Round Robin Scheduling: Impact of Quantum Size',
+                       'Quantum Size (time units)', 'Quantum Size',
+                       'rr_plot.png', 'Round Robin plot')
+
+
+def plot_all_metrics(prefix, title, xlabel, output, label):
+    """Create combined plot showing all metrics on same graph"""
+    if up_to_date(output, inputs_of(prefix)):
+        print(f"{output} is up to date")
+        return
+    df = load_summary(prefix)
+    if df is None:
+        print(f"No {prefix} results, skipping {output}")
+        return
 
-def plot_combined_metrics():
-    """Create combined plot showing all metrics on same graph for FCFS"""
-    df = pd.read_csv('fcfs_results.csv')
-    
     fig, ax = plt.subplots(figsize=(12, 7))
-    
+
     # Normalize throughput for better visualization (scale it up)
-    throughput_scaled = df['Throughput'] * 10000
-    
-    ax.plot(df['Scheduler_Latency'], throughput_scaled, 'b-', linewidth=2, label='Throughput (×10000)', marker='o', markersize=3, markevery=20)
-    ax.plot(df['Scheduler_Latency'], df['Avg_Waiting_Time'], 'r-', linewidth=2, label='Avg Waiting Time', marker='s', markersize=3, markevery=20)
-    ax.plot(df['Scheduler_Latency'], df['Avg_Turnaround_Time'], 'g-', linewidth=2, label='Avg Turnaround Time', marker='^', markersize=3, markevery=20)
-    ax.plot(df['Scheduler_Latency'], df['Avg_Response_Time'], 'm-', linewidth=2, label='Avg Response Time', marker='d', markersize=3, markevery=20)
-    
-    ax.set_xlabel('Scheduler/Dispatcher Latency (time units)', fontsize=12)
+    series = [
+        (np.asarray(df['Throughput']) * 10000, 'b-', 'Throughput (×10000)', 'o'),
+        (df['Avg_Waiting_Time'], 'r-', 'Avg Waiting Time', 's'),
+        (df['Avg_Turnaround_Time'], 'g-', 'Avg Turnaround Time', '^'),
+        (df['Avg_Response_Time'], 'm-', 'Avg Response Time', 'd'),
+    ]
+    for values, style, name, marker in series:
+        x, y = downsample(df['Sweep'], values)
+        ax.plot(x, y, style, linewidth=2, label=name, marker=marker, markersize=3,
+                markevery=max(1, len(x) // 10))
+
+    ax.set_xlabel(xlabel, fontsize=12)
     ax.set_ylabel('Metric Value', fontsize=12)
-    ax.set_title('FCFS Scheduling: All Metrics vs Scheduler/Dispatcher Latency', fontsize=14, fontweight='bold')
+    ax.set_title(title, fontsize=14, fontweight='bold')
     ax.grid(True, alpha=0.3)
     ax.legend(loc='best', fontsize=10)
-    
-    plt.tight_layout()
-    plt.savefig('fcfs_combined_plot.png', dpi=300, bbox_inches='tight')
-    print("FCFS combined plot saved as fcfs_combined_plot.png")
-    plt.show()
+
+    save(fig, output, label)
+
+
+def plot_combined_metrics():
+    """Create combined plot showing all metrics on same graph for FCFS"""
+    plot_all_metrics('fcfs', 'FCFS Scheduling: All Metrics vs Scheduler/Dispatcher Latency',
+                     'Scheduler/Dispatcher Latency (time units)',
+                     'fcfs_combined_plot.png', 'FCFS combined plot')
+
 
 def plot_rr_combined_metrics():
     """Create combined plot showing all metrics on same graph for RR"""
-    df = pd.read_csv('rr_results.csv')
-    
-    fig, ax = plt.subplots(figsize=(12, 7))
-    
-    # Normalize throughput for better visualization
-    throughput_scaled = df['Throughput'] * 10000
-    
-    ax.plot(df['Quantum_Size'], throughput_scaled, 'b-', linewidth=2, label='Throughput (×10000)', marker='o', markersize=3, markevery=20)
-    ax.plot(df['Quantum_Size'], df['Avg_Waiting_Time'], 'r-', linewidth=2, label='Avg Waiting Time', marker='s', markersize=3, markevery=20)
-    ax.plot(df['Quantum_Size'], df['Avg_Turnaround_Time'], 'g-', linewidth=2, label='Avg Turnaround Time', marker='^', markersize=3, markevery=20)
-    ax.plot(df['Quantum_Size'], df['Avg_Response_Time'], 'm-', linewidth=2, label='Avg Response Time', marker='d', markersize=3, markevery=20)
-    
-    ax.set_xlabel('Quantum Size (time units)', fontsize=12)
-    ax.set_ylabel('Metric Value', fontsize=12)
-    ax.set_title('Round Robin Scheduling: All Metrics vs Quantum Size', fontsize=14, fontweight='bold')
-    ax.grid(True, alpha=0.3)
-    ax.legend(loc='best', fontsize=10)
-    
-    plt.tight_layout()
-    plt.savefig('rr_combined_plot.png', dpi=300, bbox_inches='tight')
-    print("RR combined plot saved as rr_combined_plot.png")
-    plt.show()
+    plot_all_metrics('rr', 'Round Robin Scheduling: All Metrics vs Quantum Size',
+                     'Quantum Size (time units)',
+                     'rr_combined_plot.png', 'RR combined plot')
+
+
+def plot_policy_comparison():
+    """FCFS vs RR vs MLFQ (and fair share when present) at the same dispatcher
+    latency. RR and fair share are curves over the quantum; FCFS at latency
+    LATENCY and the MLFQ run are single points drawn as horizontal lines."""
+    output = 'comparison_plot.png'
+    inputs = inputs_of('fcfs') + inputs_of('rr') + inputs_of('fs') + ['mlfq_results.npy']
+    if up_to_date(output, inputs):
+        print(f"{output} is up to date")
+        return
+    fcfs = load_summary('fcfs')
+    rr = load_summary('rr')
+    fs = load_summary('fs')
+    mlfq = None
+    if os.path.exists('mlfq_results.npy'):
+        row = np.load('mlfq_results.npy')[0]
+        mlfq = {name: row[i] for i, name in enumerate(MLFQ_COLUMNS)}
+    if rr is None:
+        print(f"No rr results, skipping {output}")
+        return
+
+    fig, axes = plt.subplots(2, 2, figsize=(14, 10))
+    fig.suptitle(f'Policy Comparison at Dispatcher Latency {LATENCY}', fontsize=16, fontweight='bold')
+
+    panels = [
+        (axes[0, 0], 'Throughput', None, 'Throughput (processes/time unit)'),
+        (axes[0, 1], 'Avg_Waiting_Time', 'Waiting_Time', 'Average Waiting Time (time units)'),
+        (axes[1, 0], 'Avg_Turnaround_Time', 'Turnaround_Time', 'Average Turnaround Time (time units)'),
+        (axes[1, 1], 'Avg_Response_Time', 'Response_Time', 'Average Response Time (time units)'),
+    ]
+    for ax, column, detail, ylabel in panels:
+        for prefix, df, style, name in (('rr', rr, 'b-', 'Round Robin'), ('fs', fs, 'g-', 'Fair share')):
+            if df is None:
+                continue
+            x, y = downsample(df['Sweep'], df[column])
+            ax.plot(x, y, style, linewidth=2, label=name)
+            bands = load_bands(prefix, detail) if detail else None
+            if bands is not None:
+                draw_band(ax, df['Sweep'], bands, style[0], 0.12)
+
+        if fcfs is not None:
+            point = np.flatnonzero(np.asarray(fcfs['Sweep']) == LATENCY)
+            if len(point) > 0:
+                ax.axhline(fcfs[column][point[0]], color='r', linestyle='--', linewidth=1.5,
+                           label=f'FCFS (latency {LATENCY})')
+        if mlfq is not None:
+            ax.axhline(mlfq[column], color='m', linestyle=':', linewidth=2,
+                       label=f'MLFQ (Q1={int(mlfq["Quantum_Q1"])}, Q2={int(mlfq["Quantum_Q2"])})')
+
+        ax.set_xlabel('Quantum Size (time units)', fontsize=11)
+        ax.set_ylabel(ylabel, fontsize=11)
+        ax.set_title(ylabel.split(' (')[0], fontsize=12, fontweight='bold')
+        ax.grid(True, alpha=0.3)
+        ax.legend(fontsize=9)
+
+    save(fig, output, 'Policy comparison plot')
+
+
+def check_downsampling():
+    """Self-test on a synthetic 10k-point sweep: both band edges share one x
+    array, the band covers every original p10/p90 value, and a one-point
+    spike in the curve survives"""
+    n = 10000
+    x = np.arange(n)
+    rng = np.random.default_rng(457)
+    low = rng.normal(100, 20, n)
+    high = low + rng.uniform(0, 50, n)
+    curve = (low + high) / 2
+    curve[n // 3] = 1e6
+
+    cx, cy = downsample(x, curve)
+    assert len(cx) <= MAX_POINTS and cy.max() == 1e6, "spike lost"
+
+    band_x, band_low, band_high = downsample_band(x, low, high)
+    assert len(band_x) == len(band_low) == len(band_high) <= MAX_POINTS, "band edges differ in length"
+    assert np.all(np.diff(band_x) >= 0), "band x not sorted"
+    assert band_x[0] == x[0] and band_x[-1] == x[-1], "band does not span the sweep"
+    for i in range(0, len(band_x), 2):
+        inside = (x >= band_x[i]) & (x <= band_x[i + 1])
+        assert band_low[i] <= low[inside].min() and band_high[i] >= high[inside].max(), \
+            f"band narrower than the data at x={band_x[i]}"
+    print(f"Downsampling check passed: {n} points -> {len(cx)} curve, {len(band_x)} band")
+
 
 if __name__ == "__main__":
+    if '--check' in sys.argv:
+        check_downsampling()
+        sys.exit(0)
+
     print("Generating plots...")
     print("\n1. FCFS Plots")
     plot_fcfs_results()
     plot_combined_metrics()
-    
+
     print("\n2. Round Robin Plots")
     plot_rr_results()
     plot_rr_combined_metrics()
-    
-    print("\nAll plots generated successfully!")
\ No newline at end of file
+
+    print("\n3. Policy Comparison")
+    plot_policy_comparison()
+
+    print("\nAll plots generated successfully!")
@@ -0,0 +1,170 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef SIM_STATS
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#endif
+
+// Hot-path counters and per-phase timers shared by a2p1-a2p4. They are
+// compiled in only with -DSIM_STATS (make stats); in a default build every
+// STAT_ macro expands to nothing, so the sweep runs exactly as fast as
+// without them.
+typedef enum {
+    PHASE_PARSE,
+    PHASE_SIMULATE,
+    PHASE_AGGREGATE,
+    PHASE_WRITE,
+    NUM_PHASES
+} Phase;
+
+typedef enum {
+    STATS_OFF,
+    STATS_TABLE,
+    STATS_JSON
+} StatsFormat;
+
+// Counters a simulator can update. Each program passes the ones it actually
+// increments to report_stats(), so no counter is reported as a constant 0.
+#define COUNT_LOOP_ITERATIONS (1 << 0)
+#define COUNT_DISPATCHES (1 << 1)
+#define COUNT_ENQUEUES (1 << 2)
+#define COUNT_DEQUEUES (1 << 3)
+#define COUNT_IDLE_JUMPS (1 << 4)
+#define COUNT_DEMOTIONS (1 << 5)
+
+#ifdef SIM_STATS
+typedef struct {
+    long long loop_iterations;
+    long long dispatches;
+    long long enqueues;
+    long long dequeues;
+    long long idle_jumps;
+    long long demotions;
+    long long phase_ns[NUM_PHASES];
+    unsigned long long phase_cycles[NUM_PHASES];
+    long long start_ns[NUM_PHASES];
+    unsigned long long start_cycles[NUM_PHASES];
+} SimStats;
+
+static SimStats sim_stats;
+
+static const char *phase_names[] = { "parse", "simulate", "aggregate", "write" };
+
+// The TSC on x86 and the virtual counter on aarch64 (a fixed-frequency
+// timer, not core cycles). Other targets have no counter we can read from
+// user space, so the cycles column is left out there.
+#if defined(__x86_64__) || defined(__i386__)
+#define STATS_HAVE_CYCLES 1
+static inline unsigned long long read_cycles(void) {
+    return __rdtsc();
+}
+#elif defined(__aarch64__)
+#define STATS_HAVE_CYCLES 1
+static inline unsigned long long read_cycles(void) {
+    unsigned long long ticks;
+    __asm__ volatile("isb; mrs %0, cntvct_el0" : "=r"(ticks) : : "memory");
+    return ticks;
+}
+#else
+#define STATS_HAVE_CYCLES 0
+static inline unsigned long long read_cycles(void) {
+    return 0;
+}
+#endif
+
+static inline long long read_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static inline void stats_start(Phase phase) {
+    sim_stats.start_ns[phase] = read_ns();
+    sim_stats.start_cycles[phase] = read_cycles();
+}
+
+static inline void stats_stop(Phase phase) {
+    sim_stats.phase_cycles[phase] += read_cycles() - sim_stats.start_cycles[phase];
+    sim_stats.phase_ns[phase] += read_ns() - sim_stats.start_ns[phase];
+}
+
+#define STAT_INC(counter) (sim_stats.counter++)
+#define STAT_START(phase) stats_start(phase)
+#define STAT_STOP(phase) stats_stop(phase)
+#else
+#define STAT_INC(counter) ((void)0)
+#define STAT_START(phase) ((void)0)
+#define STAT_STOP(phase) ((void)0)
+#endif
+
+// Print the counters selected by the COUNT_ mask to stderr, keeping stdout
+// unchanged
+static inline void report_stats(StatsFormat format, unsigned int counters) {
+#ifdef SIM_STATS
+    const char *all_names[] = { "loop_iterations", "dispatches", "enqueues", "dequeues", "idle_jumps", "demotions" };
+    long long all_values[] = { sim_stats.loop_iterations, sim_stats.dispatches, sim_stats.enqueues,
+                               sim_stats.dequeues, sim_stats.idle_jumps, sim_stats.demotions };
+    const char *counter_names[6];
+    long long values[6];
+    int num_counters = 0;
+    long long total_ns = 0;
+    
+    for (int i = 0; i < 6; i++) {
+        if (counters & (1u << i)) {
+            counter_names[num_counters] = all_names[i];
+            values[num_counters++] = all_values[i];
+        }
+    }
+    for (int p = 0; p < NUM_PHASES; p++) total_ns += sim_stats.phase_ns[p];
+    
+    if (format == STATS_JSON) {
+        fprintf(stderr, "{\"counters\":{");
+        for (int i = 0; i < num_counters; i++) {
+            fprintf(stderr, "%s\"%s\":%lld", i ? "," : "", counter_names[i], values[i]);
+        }
+        fprintf(stderr, "},\"phases\":{");
+        for (int p = 0; p < NUM_PHASES; p++) {
+            fprintf(stderr, "%s\"%s\":{\"ns\":%lld", p ? "," : "", phase_names[p], sim_stats.phase_ns[p]);
+            if (STATS_HAVE_CYCLES) fprintf(stderr, ",\"cycles\":%llu", sim_stats.phase_cycles[p]);
+            fprintf(stderr, "}");
+        }
+        fprintf(stderr, "}}\n");
+    } else if (format == STATS_TABLE) {
+        fprintf(stderr, "\n%-16s %16s\n", "Counter", "Value");
+        for (int i = 0; i < num_counters; i++) {
+            fprintf(stderr, "%-16s %16lld\n", counter_names[i], values[i]);
+        }
+        fprintf(stderr, "\n%-16s %12s", "Phase", "Time_ms");
+        if (STATS_HAVE_CYCLES) fprintf(stderr, " %16s", "Cycles");
+        fprintf(stderr, " %7s\n", "Share");
+        for (int p = 0; p < NUM_PHASES; p++) {
+            fprintf(stderr, "%-16s %12.3f", phase_names[p], sim_stats.phase_ns[p] / 1e6);
+            if (STATS_HAVE_CYCLES) fprintf(stderr, " %16llu", sim_stats.phase_cycles[p]);
+            fprintf(stderr, " %6.1f%%\n", total_ns ? 100.0 * sim_stats.phase_ns[p] / total_ns : 0.0);
+        }
+    }
+#else
+    (void)format;
+    (void)counters;
+#endif
+}
+
+static inline int parse_stats_format(const char *arg, StatsFormat *format) {
+    if (strcmp(arg, "--stats") == 0 || strcmp(arg, "--stats=table") == 0) *format = STATS_TABLE;
+    else if (strcmp(arg, "--stats=json") == 0) *format = STATS_JSON;
+    else return 0;
+    
+#ifndef SIM_STATS
+    fprintf(stderr, "--stats needs a build with -DSIM_STATS (make stats)\n");
+    exit(1);
+#endif
+    return 1;
+}
+
+#endif
@@ -23,6 +23,9 @@ fi
 echo -e "${GREEN}✓ Input file found${NC}"
 echo ""
 
+# Checks that must hold; the script exits non-zero if any of them fail
+FAILED=0
+
 # Compile all programs
 echo "Compiling programs..."
 echo "----------------------"
@@ -51,6 +54,54 @@ else
     exit 1
 fi
 
+gcc -O2 a2p4.c -o a2p4 2>&1
+if [ $? -eq 0 ]; then
+    echo -e "${GREEN}✓ a2p4 compiled successfully${NC}"
+else
+    echo -e "${RED}✗ a2p4 compilation failed${NC}"
+    exit 1
+fi
+
+gcc -O2 a2sort.c -o a2sort 2>&1
+if [ $? -eq 0 ]; then
+    echo -e "${GREEN}✓ a2sort compiled successfully${NC}"
+else
+    echo -e "${RED}✗ a2sort compilation failed${NC}"
+    exit 1
+fi
+
+gcc -O2 a2import.c -o a2import 2>&1
+if [ $? -eq 0 ]; then
+    echo -e "${GREEN}✓ a2import compiled successfully${NC}"
+else
+    echo -e "${RED}✗ a2import compilation failed${NC}"
+    exit 1
+fi
+
+gcc -O2 -pthread a2serve.c -o a2serve 2>&1
+if [ $? -eq 0 ]; then
+    echo -e "${GREEN}✓ a2serve compiled successfully${NC}"
+else
+    echo -e "${RED}✗ a2serve compilation failed${NC}"
+    exit 1
+fi
+
+gcc -O2 -pthread a2boot.c -o a2boot 2>&1
+if [ $? -eq 0 ]; then
+    echo -e "${GREEN}✓ a2boot compiled successfully${NC}"
+else
+    echo -e "${RED}✗ a2boot compilation failed${NC}"
+    exit 1
+fi
+
+gcc -O2 -pthread a2calib.c -o a2calib 2>&1
+if [ $? -eq 0 ]; then
+    echo -e "${GREEN}✓ a2calib compiled successfully${NC}"
+else
+    echo -e "${RED}✗ a2calib compilation failed${NC}"
+    exit 1
+fi
+
 echo ""
 
 # Run Part 1: FCFS
@@ -140,13 +191,317 @@ else
 fi
 echo ""
 
+# Run Part 4: Fair share
+echo "Running Part 4: Fair share..."
+echo "-----------------------------"
+./a2p4 < inputfile1.csv > /dev/null
+if [ $? -eq 0 ] && [ -f "fs_results.csv" ] && [ -f "fs_results_details.csv" ]; then
+    echo -e "${GREEN}✓ Fair-share simulation completed${NC}"
+    lines=$(wc -l < fs_results.csv)
+    if [ $lines -eq 201 ]; then
+        echo -e "  ${GREEN}✓ Correct number of summary lines${NC}"
+    else
+        echo -e "  ${RED}✗ Expected 201 lines, got $lines${NC}"
+        FAILED=1
+    fi
+else
+    echo -e "${RED}✗ Fair-share simulation failed${NC}"
+    FAILED=1
+fi
+
+# Two CPU-bound PIDs with weights 2048 and 1024 at quantum 1: every slice
+# costs LATENCY + 1 = 21 time units, and PID 1 should get two slices for each
+# one PID 2 gets. So PID 1 finishes first, at slice 150 (time 3150), having
+# run 100 units to PID 2's 50, and PID 2 finishes last at slice 200.
+FS_TMP=$(mktemp -d)
+printf 'Pid,Arrival Time,Time until first Response,Burst Length\n1,0,0,100\n2,0,0,100\n' > "$FS_TMP/trace.csv"
+printf 'Pid,Weight\n1,2048\n' > "$FS_TMP/weights.csv"
+a2p4_path="$(pwd)/a2p4"
+(cd "$FS_TMP" && "$a2p4_path" --weights=weights.csv < trace.csv > /dev/null)
+finish1=$(awk -F, '$1 == 1 && $2 == 1 { print $5 }' "$FS_TMP/fs_results_details.csv")
+finish2=$(awk -F, '$1 == 1 && $2 == 2 { print $5 }' "$FS_TMP/fs_results_details.csv")
+if [ -n "$finish1" ] && [ -n "$finish2" ] && [ "$finish1" -lt "$finish2" ]; then
+    echo -e "  ${GREEN}✓ weight 2048 PID finishes first ($finish1 < $finish2)${NC}"
+else
+    echo -e "  ${RED}✗ weighted PID did not finish first (PID 1: $finish1, PID 2: $finish2)${NC}"
+    FAILED=1
+fi
+share2=$(( ${finish1:-0} / 21 - 100 ))
+if [ "$share2" -eq 50 ] && [ "$finish2" = "4200" ]; then
+    echo -e "  ${GREEN}✓ 2:1 CPU share (PID 2 ran $share2 of 100 units meanwhile)${NC}"
+else
+    echo -e "  ${RED}✗ expected a 2:1 share, PID 2 ran $share2 units while PID 1 ran 100${NC}"
+    FAILED=1
+fi
+rm -rf "$FS_TMP"
+echo ""
+
+# Quantum optimizer: the coarse-to-fine search must land on the same quantum
+# as the exhaustive sweep in rr_results.csv (ties keep the smaller quantum)
+echo "Running quantum optimizer..."
+echo "----------------------------"
+for objective in avg_wait:3 avg_tat:4 avg_rt:5; do
+    metric=${objective%%:*}
+    column=${objective##*:}
+    exhaustive=$(awk -F, -v c=$column 'NR > 1 && (best == "" || $c + 0 < value) { value = $c + 0; best = $1 } END { print best }' rr_results.csv)
+    result=$(./a2p2 --optimize=$metric < inputfile1.csv)
+    optimized=$(echo "$result" | tail -1 | cut -d, -f1)
+    evaluations=$(echo "$result" | grep Evaluated)
+    if [ -n "$exhaustive" ] && [ "$optimized" = "$exhaustive" ]; then
+        echo -e "  ${GREEN}✓ $metric: quantum $optimized matches exhaustive best ($evaluations)${NC}"
+    else
+        echo -e "  ${RED}✗ $metric: optimizer chose $optimized, exhaustive best is $exhaustive${NC}"
+        FAILED=1
+    fi
+done
+echo ""
+
+# Bootstrap: the 95% intervals around the FCFS sweep must contain the
+# unperturbed results from Part 1, and a fixed seed must give the same file
+# whatever the number of workers (replicas are seeded by index, not worker)
+echo "Running bootstrap confidence intervals..."
+echo "-----------------------------------------"
+BOOT_TMP=$(mktemp -d)
+a2boot_path="$(pwd)/a2boot"
+input_path="$(pwd)/inputfile1.csv"
+for workers in 1 4; do
+    mkdir "$BOOT_TMP/w$workers"
+    (cd "$BOOT_TMP/w$workers" && "$a2boot_path" --policy=fcfs --replicas=200 --seed=7 --workers=$workers < "$input_path" > /dev/null 2>&1)
+done
+outside=$(paste -d, <(tail -n +2 fcfs_results.csv) <(tail -n +2 "$BOOT_TMP/w1/fcfs_bootstrap.csv") |
+          awk -F, '{ for (m = 0; m < 4; m++) if ($(2 + m) < $(8 + 3 * m) || $(2 + m) > $(9 + 3 * m)) bad++ } END { print NR == 200 ? bad + 0 : -1 }')
+if [ "$outside" = "0" ]; then
+    echo -e "  ${GREEN}✓ every CI contains the unperturbed FCFS result${NC}"
+else
+    echo -e "  ${RED}✗ unperturbed FCFS result outside the CI (${outside})${NC}"
+    FAILED=1
+fi
+if cmp -s "$BOOT_TMP/w1/fcfs_bootstrap.csv" "$BOOT_TMP/w4/fcfs_bootstrap.csv"; then
+    echo -e "  ${GREEN}✓ --seed=7 gives the same intervals on 1 and 4 workers${NC}"
+else
+    echo -e "  ${RED}✗ bootstrap output depends on the number of workers${NC}"
+    FAILED=1
+fi
+rm -rf "$BOOT_TMP"
+echo ""
+
+# Calibration pins to CPUs from its affinity mask, not CPUs 0 and 1: confined
+# to the last allowed CPU it must pin there, and refuse --pin=cross
+echo "Running latency calibration..."
+echo "------------------------------"
+CALIB_TMP=$(mktemp -d)
+last_cpu=$(awk -F'[ \t,-]+' '/^Cpus_allowed_list/ { print $NF }' /proc/self/status)
+if command -v taskset > /dev/null; then
+    taskset -c $last_cpu ./a2calib --iterations=200 --output="$CALIB_TMP/dist.csv" > "$CALIB_TMP/calib.log" 2>&1
+    if [ $? -eq 0 ] && grep -q "^Pinning to CPU $last_cpu\$" "$CALIB_TMP/calib.log" && ! grep -q "unpinned" "$CALIB_TMP/calib.log" &&
+       [ -s "$CALIB_TMP/dist.csv" ]; then
+        echo -e "  ${GREEN}✓ pinned to CPU $last_cpu from the affinity mask${NC}"
+    else
+        echo -e "  ${RED}✗ calibration did not pin to allowed CPU $last_cpu${NC}"
+        FAILED=1
+    fi
+    if ! taskset -c $last_cpu ./a2calib --iterations=200 --pin=cross --output="$CALIB_TMP/cross.csv" > /dev/null 2>&1 &&
+       [ ! -e "$CALIB_TMP/cross.csv" ]; then
+        echo -e "  ${GREEN}✓ --pin=cross on one CPU exits with an error${NC}"
+    else
+        echo -e "  ${RED}✗ --pin=cross on one CPU did not fail${NC}"
+        FAILED=1
+    fi
+else
+    echo "  (skipped: taskset not available)"
+fi
+rm -rf "$CALIB_TMP"
+echo ""
+
+# External sort: 100 copies of inputfile1.csv (shifted in time) shuffled and
+# sorted with 1 MB of memory must spill several runs and come back in stable
+# arrival order. inputfile1.csv has CRLF rows; a2sort writes LF.
+echo "Running external sort..."
+echo "------------------------"
+SORT_TMP=$(mktemp -d)
+for copy in $(seq 0 99); do
+    tail -n +2 inputfile1.csv | tr -d '\r' | awk -F, -v OFS=, -v copy=$copy '{ $2 += copy * 6000; print }'
+done > "$SORT_TMP/rows.csv"
+(head -1 inputfile1.csv; shuf --random-source=<(yes) "$SORT_TMP/rows.csv") > "$SORT_TMP/shuffled.csv"
+./a2sort --memory=1 "$SORT_TMP/shuffled.csv" > "$SORT_TMP/sorted.csv" 2> "$SORT_TMP/sort.log"
+runs=$(sed -n 's/.* \([0-9]*\) spilled runs.*/\1/p' "$SORT_TMP/sort.log")
+if [ "${runs:-0}" -gt 1 ]; then
+    echo -e "  ${GREEN}✓ sorted in $runs spilled runs${NC}"
+else
+    echo -e "  ${RED}✗ expected several spilled runs, got '${runs}'${NC}"
+    FAILED=1
+fi
+tail -n +2 "$SORT_TMP/shuffled.csv" | sort -s -t, -k2,2n > "$SORT_TMP/expected.csv"
+if tail -n +2 "$SORT_TMP/sorted.csv" | cmp -s - "$SORT_TMP/expected.csv" &&
+   sort "$SORT_TMP/rows.csv" | cmp -s - <(tail -n +2 "$SORT_TMP/sorted.csv" | sort); then
+    echo -e "  ${GREEN}✓ output is the original rows in stable arrival order${NC}"
+else
+    echo -e "  ${RED}✗ a2sort output differs from the sorted original${NC}"
+    FAILED=1
+fi
+
+# A --memory far beyond what the host can give must be reported as an
+# allocation failure, not overflow the chunk size or crash
+(ulimit -v 1000000; ./a2sort --memory=2147483647 "$SORT_TMP/shuffled.csv" > /dev/null 2> "$SORT_TMP/oom.log")
+if [ $? -eq 1 ] && grep -q "Out of memory" "$SORT_TMP/oom.log"; then
+    echo -e "  ${GREEN}✓ oversized --memory reported as out of memory${NC}"
+else
+    echo -e "  ${RED}✗ oversized --memory not handled${NC}"
+    FAILED=1
+fi
+
+# The simulators sort unsorted input themselves, with a warning, and must
+# give the same results as on the sorted file
+(head -1 inputfile1.csv; tail -n +2 inputfile1.csv | shuf --random-source=<(yes)) > "$SORT_TMP/input_shuffled.csv"
+(head -1 inputfile1.csv; tail -n +2 "$SORT_TMP/input_shuffled.csv" | sort -s -t, -k2,2n) > "$SORT_TMP/input_sorted.csv"
+a2p1_path="$(pwd)/a2p1"
+mkdir "$SORT_TMP/shuffled" "$SORT_TMP/sorted"
+(cd "$SORT_TMP/shuffled" && "$a2p1_path" < ../input_shuffled.csv > /dev/null 2> warning.txt)
+(cd "$SORT_TMP/sorted" && "$a2p1_path" < ../input_sorted.csv > /dev/null 2> warning.txt)
+if grep -q "not sorted by arrival" "$SORT_TMP/shuffled/warning.txt" && [ ! -s "$SORT_TMP/sorted/warning.txt" ]; then
+    echo -e "  ${GREEN}✓ a2p1 warns about unsorted input${NC}"
+else
+    echo -e "  ${RED}✗ a2p1 did not warn about unsorted input${NC}"
+    FAILED=1
+fi
+if cmp -s "$SORT_TMP/shuffled/fcfs_results_details.csv" "$SORT_TMP/sorted/fcfs_results_details.csv"; then
+    echo -e "  ${GREEN}✓ unsorted input gives the same FCFS results${NC}"
+else
+    echo -e "  ${RED}✗ FCFS results differ for unsorted input${NC}"
+    FAILED=1
+fi
+rm -rf "$SORT_TMP"
+echo ""
+
+# Trace import: the same short schedule as an ftrace dump (with TGIDs) and
+# as old-style perf sched script output must give the same bursts. Worker 101
+# is preempted once and keeps its burst; both tasks belong to process 100.
+echo "Running trace importer..."
+echo "-------------------------"
+IMPORT_TMP=$(mktemp -d)
+cat > "$IMPORT_TMP/ftrace.txt" << 'EOF'
+# tracer: nop
+          <idle>-0       (    0) [000] d..2  100.000000: sched_wakeup: comm=worker pid=101 prio=120 target_cpu=000
+          <idle>-0       (    0) [000] d..2  100.000010: sched_switch: prev_comm=swapper/0 prev_pid=0 prev_prio=120 prev_state=R ==> next_comm=worker next_pid=101 next_prio=120
+          worker-101     (  100) [000] d..2  100.000050: sched_wakeup: comm=helper pid=102 prio=120 target_cpu=000
+          worker-101     (  100) [000] d..2  100.000060: sched_switch: prev_comm=worker prev_pid=101 prev_prio=120 prev_state=R ==> next_comm=helper next_pid=102 next_prio=120
+          helper-102     (  100) [000] d..2  100.000090: sched_switch: prev_comm=helper prev_pid=102 prev_prio=120 prev_state=S ==> next_comm=worker next_pid=101 next_prio=120
+          worker-101     (  100) [000] d..2  100.000120: sched_switch: prev_comm=worker prev_pid=101 prev_prio=120 prev_state=S ==> next_comm=swapper/0 next_pid=0 next_prio=120
+EOF
+cat > "$IMPORT_TMP/perf.txt" << 'EOF'
+         swapper     0/0     [000]   200.000000: sched:sched_wakeup: worker:101 [120] success=1 CPU:000
+         swapper     0/0     [000]   200.000010: sched:sched_switch: swapper/0:0 [120] R ==> worker:101 [120]
+          worker   100/101   [000]   200.000050: sched:sched_wakeup: helper:102 [120] success=1 CPU:000
+          worker   100/101   [000]   200.000060: sched:sched_switch: worker:101 [120] R ==> helper:102 [120]
+          helper   100/102   [000]   200.000090: sched:sched_switch: helper:102 [120] S ==> worker:101 [120]
+          worker   100/101   [000]   200.000120: sched:sched_switch: worker:101 [120] S ==> swapper/0:0 [120]
+EOF
+printf 'Pid,Arrival Time,Time until first Response,Burst Length\n100,0,0,80\n100,50,0,30\n' > "$IMPORT_TMP/expected.csv"
+for format in ftrace perf; do
+    if ./a2import "$IMPORT_TMP/$format.txt" 2> /dev/null | cmp -s - "$IMPORT_TMP/expected.csv"; then
+        echo -e "  ${GREEN}✓ $format dump imported correctly${NC}"
+    else
+        echo -e "  ${RED}✗ $format dump imported incorrectly${NC}"
+        FAILED=1
+    fi
+done
+
+# An hour later, arrivals in microseconds no longer fit the simulators' int
+# fields: the importer must refuse rather than write wrapped-around times
+tail -n +2 "$IMPORT_TMP/ftrace.txt" | sed -e 's/ 100\.0000/ 3700.0000/' > "$IMPORT_TMP/late.txt"
+cat "$IMPORT_TMP/ftrace.txt" "$IMPORT_TMP/late.txt" > "$IMPORT_TMP/long.txt"
+if ! ./a2import "$IMPORT_TMP/long.txt" > /dev/null 2>&1; then
+    echo -e "  ${GREEN}✓ time overflow rejected at --unit-ns=1000${NC}"
+else
+    echo -e "  ${RED}✗ time overflow not detected${NC}"
+    FAILED=1
+fi
+if ./a2import --unit-ns=1000000 "$IMPORT_TMP/long.txt" 2> /dev/null | grep -q '^100,3600000,'; then
+    echo -e "  ${GREEN}✓ coarser --unit-ns imports the long dump${NC}"
+else
+    echo -e "  ${RED}✗ long dump not imported at --unit-ns=1000000${NC}"
+    FAILED=1
+fi
+rm -rf "$IMPORT_TMP"
+echo ""
+
+# Query server: a round trip must match the RR sweep, and a client that
+# pipelines requests without reading its replies must not stall anyone else
+echo "Running query server..."
+echo "-----------------------"
+SERVE_TMP=$(mktemp -d)
+SOCK="$SERVE_TMP/a2serve.sock"
+./a2serve --workers=2 "$SOCK" main=inputfile1.csv > "$SERVE_TMP/serve.log" 2>&1 &
+SERVE_PID=$!
+for i in $(seq 50); do
+    [ -S "$SOCK" ] && break
+    sleep 0.1
+done
+reply=$(timeout 10 ./a2serve --query "$SOCK" "SIM trace=main policy=rr quantum=10")
+got=$(echo "$reply" | awk '{ for (i = 2; i <= NF; i++) { split($i, kv, "="); v[kv[1]] = kv[2] }
+                           printf "10,%.6f,%.2f,%.2f,%.2f\n", v["throughput"], v["avg_wait"], v["avg_tat"], v["avg_rt"] }')
+if [ "$got" = "$(grep '^10,' rr_results.csv)" ]; then
+    echo -e "  ${GREEN}✓ --query round trip matches rr_results.csv${NC}"
+else
+    echo -e "  ${RED}✗ --query reply '$reply' does not match rr_results.csv${NC}"
+    FAILED=1
+fi
+if command -v python3 > /dev/null; then
+    python3 -c '
+import socket, sys, time
+s = socket.socket(socket.AF_UNIX)
+s.connect(sys.argv[1])
+s.setblocking(False)
+data = b"SIM trace=main policy=rr quantum=10\n" * 2500
+deadline = time.time() + 5
+while data and time.time() < deadline:
+    try:
+        data = data[s.send(data):]
+    except BlockingIOError:
+        time.sleep(0.01)
+time.sleep(10)
+' "$SOCK" &
+    HOG_PID=$!
+    sleep 1
+    if timeout 5 ./a2serve --query "$SOCK" "SIM trace=main policy=fcfs" | grep -q '^OK'; then
+        echo -e "  ${GREEN}✓ server answers while another client ignores its replies${NC}"
+    else
+        echo -e "  ${RED}✗ server stalled behind a client that does not read${NC}"
+        FAILED=1
+    fi
+    kill $HOG_PID 2> /dev/null
+    wait $HOG_PID 2> /dev/null
+else
+    echo "  (skipped non-reading client check: python3 not available)"
+fi
+kill $SERVE_PID 2> /dev/null
+wait $SERVE_PID 2> /dev/null
+rm -rf "$SERVE_TMP"
+echo ""
+
+# Plot downsampling: a 10k-point synthetic sweep must keep its spike and a
+# p10-p90 band that covers every original point (needs numpy/matplotlib)
+echo "Checking plot downsampling..."
+echo "-----------------------------"
+if python3 -c "import numpy, matplotlib" 2> /dev/null; then
+    if python3 plot_results.py --check > /dev/null; then
+        echo -e "  ${GREEN}✓ bands share bucket edges and cover the data${NC}"
+    else
+        echo -e "  ${RED}✗ plot downsampling check failed${NC}"
+        FAILED=1
+    fi
+else
+    echo "  (skipped: python3 with numpy and matplotlib not available)"
+fi
+echo ""
+
 # Summary
 echo "=============================================="
 echo "Test Summary"
 echo "=============================================="
 echo ""
 
-FILES=("a2p1" "a2p2" "a2p3" "fcfs_results.csv" "fcfs_results_details.csv" "rr_results.csv" "rr_results_details.csv" "mlfq_output.txt")
+FILES=("a2p1" "a2p2" "a2p3" "a2p4" "fcfs_results.csv" "fcfs_results_details.csv" "rr_results.csv" "rr_results_details.csv" "fs_results.csv" "fs_results_details.csv" "mlfq_output.txt")
 
 for file in "${FILES[@]}"; do
     if [ -f "$file" ]; then
@@ -162,4 +517,6 @@ echo "1. Run: python3 plot_results.py (to generate plots)"
 echo "2. Review the plots and CSV files"
 echo "3. Write your reflections"
 echo "4. Compile everything into your PDF report"
-echo ""
\ No newline at end of file
+echo ""
+
+exit $FAILED
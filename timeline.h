@@ -0,0 +1,143 @@
+#ifndef TIMELINE_H
+#define TIMELINE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TIMELINE_BUFFER (1 << 20)
+#define TIMELINE_MAX_EVENT 256
+#define TIMELINE_CPU_PID 0
+
+// Streaming writer for Chrome trace-event JSON, which chrome://tracing and
+// ui.perfetto.dev open directly. Events are formatted into a fixed buffer
+// that is written out whenever it fills, so memory stays constant however
+// many slices the run produces. One simulator time unit is shown as 1 us.
+// Shared by a2p1, a2p2 and a2p3; each program is a single translation unit.
+typedef struct {
+    const char *path;
+    FILE *fp;
+    char *buffer;
+    size_t used;
+    long long events;
+} Timeline;
+
+static void timeline_flush(Timeline *tl) {
+    if (fwrite(tl->buffer, 1, tl->used, tl->fp) != tl->used) {
+        perror("timeline");
+        exit(1);
+    }
+    tl->used = 0;
+}
+
+static void timeline_str(Timeline *tl, const char *s) {
+    size_t len = strlen(s);
+    memcpy(tl->buffer + tl->used, s, len);
+    tl->used += len;
+}
+
+static void timeline_int(Timeline *tl, long long v) {
+    char digits[24];
+    int len = 0;
+    unsigned long long u = (v < 0) ? -(unsigned long long)v : (unsigned long long)v;
+    
+    if (v < 0) tl->buffer[tl->used++] = '-';
+    do {
+        digits[len++] = '0' + u % 10;
+        u /= 10;
+    } while (u > 0);
+    while (len > 0) tl->buffer[tl->used++] = digits[--len];
+}
+
+// Start an event object; every event fits in TIMELINE_MAX_EVENT bytes, so
+// the formatting below never has to check for space
+static void timeline_begin(Timeline *tl, const char *name, const char *phase, int pid, int tid, int ts) {
+    if (tl->used > TIMELINE_BUFFER - TIMELINE_MAX_EVENT) timeline_flush(tl);
+    timeline_str(tl, tl->events++ ? ",\n{\"name\":\"" : "\n{\"name\":\"");
+    timeline_str(tl, name);
+    timeline_str(tl, "\",\"ph\":\"");
+    timeline_str(tl, phase);
+    timeline_str(tl, "\",\"pid\":");
+    timeline_int(tl, pid);
+    timeline_str(tl, ",\"tid\":");
+    timeline_int(tl, tid);
+    timeline_str(tl, ",\"ts\":");
+    timeline_int(tl, ts);
+}
+
+// Open only once the trace has loaded, so a bad input never leaves a
+// truncated JSON file behind
+static Timeline *timeline_open(const char *path) {
+    Timeline *tl = malloc(sizeof(Timeline));
+    char *buffer = malloc(TIMELINE_BUFFER);
+    if (!tl || !buffer) {
+        fprintf(stderr, "Out of memory for timeline\n");
+        free(tl);
+        free(buffer);
+        return NULL;
+    }
+    tl->fp = fopen(path, "w");
+    if (!tl->fp) {
+        fprintf(stderr, "Error opening %s\n", path);
+        free(tl);
+        free(buffer);
+        return NULL;
+    }
+    tl->path = path;
+    tl->buffer = buffer;
+    tl->used = 0;
+    tl->events = 0;
+    
+    timeline_str(tl, "{\"traceEvents\":[");
+    // Dispatcher latency is drawn on its own track
+    timeline_begin(tl, "process_name", "M", TIMELINE_CPU_PID, 0, 0);
+    timeline_str(tl, ",\"args\":{\"name\":\"Scheduler\"}}");
+    timeline_begin(tl, "thread_name", "M", TIMELINE_CPU_PID, 0, 0);
+    timeline_str(tl, ",\"args\":{\"name\":\"Dispatcher\"}}");
+    return tl;
+}
+
+// Name a thread's track the first time it runs
+static void timeline_thread(Timeline *tl, int pid, int tid, int arrival_time, int burst_length) {
+    timeline_begin(tl, "thread_name", "M", pid, tid, 0);
+    timeline_str(tl, ",\"args\":{\"name\":\"Thread ");
+    timeline_int(tl, tid);
+    timeline_str(tl, " (arrival ");
+    timeline_int(tl, arrival_time);
+    timeline_str(tl, ", burst ");
+    timeline_int(tl, burst_length);
+    timeline_str(tl, ")\"}}");
+}
+
+static void timeline_dispatch(Timeline *tl, int ts, int latency) {
+    timeline_begin(tl, "dispatch", "X", TIMELINE_CPU_PID, 0, ts);
+    timeline_str(tl, ",\"dur\":");
+    timeline_int(tl, latency);
+    timeline_str(tl, "}");
+}
+
+static void timeline_run(Timeline *tl, const char *name, int pid, int tid, int ts, int dur, int remaining) {
+    timeline_begin(tl, name, "X", pid, tid, ts);
+    timeline_str(tl, ",\"dur\":");
+    timeline_int(tl, dur);
+    timeline_str(tl, ",\"args\":{\"remaining\":");
+    timeline_int(tl, remaining);
+    timeline_str(tl, "}}");
+}
+
+// preempt / demote / finish markers on the thread's track
+static void timeline_mark(Timeline *tl, const char *name, int pid, int tid, int ts) {
+    timeline_begin(tl, name, "i", pid, tid, ts);
+    timeline_str(tl, ",\"s\":\"t\"}");
+}
+
+static void timeline_close(Timeline *tl) {
+    timeline_str(tl, "\n]}\n");
+    timeline_flush(tl);
+    fclose(tl->fp);
+    printf("Timeline with %lld events saved to %s\n", tl->events, tl->path);
+    free(tl->buffer);
+    free(tl);
+}
+
+#endif
@@ -0,0 +1,151 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define LATENCY 20
+#define MAX_LATENCY_BINS 4096
+
+// Trace loading helpers shared by the simulators, a2serve and a2boot; each
+// program is a single translation unit. Include after the program's Thread
+// typedef and MAX_LINE: only pid, proc_idx and arrival_time are used.
+
+// Empirical dispatcher latency distribution (e.g. measured by a2calib),
+// stored as a cumulative histogram for sampling
+typedef struct {
+    int num_bins;
+    int latency[MAX_LATENCY_BINS];
+    long long cumulative[MAX_LATENCY_BINS];
+    unsigned long long seed;
+} LatencyDist;
+
+// The simulators walk the threads in arrival order. Out-of-order input is
+// reported and stable-sorted (bottom-up merge sort), so threads that arrive
+// together keep their file order. Returns 0 if out of memory.
+static inline int sort_by_arrival(Thread threads[], int n) {
+    int out_of_order = 0;
+    for (int i = 1; i < n; i++) {
+        if (threads[i].arrival_time < threads[i - 1].arrival_time) out_of_order++;
+    }
+    if (out_of_order == 0) return 1;
+    
+    fprintf(stderr, "Warning: input not sorted by arrival time (%d rows out of order), sorting\n", out_of_order);
+    
+    Thread *tmp = malloc(n * sizeof(Thread));
+    if (!tmp) return 0;
+    Thread *src = threads, *dst = tmp;
+    for (int width = 1; width < n; width *= 2) {
+        for (int lo = 0; lo < n; lo += 2 * width) {
+            int mid = (lo + width < n) ? lo + width : n;
+            int hi = (lo + 2 * width < n) ? lo + 2 * width : n;
+            int i = lo, j = mid, k = lo;
+            while (i < mid && j < hi) {
+                dst[k++] = (src[j].arrival_time < src[i].arrival_time) ? src[j++] : src[i++];
+            }
+            while (i < mid) dst[k++] = src[i++];
+            while (j < hi) dst[k++] = src[j++];
+        }
+        Thread *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    if (src != threads) memcpy(threads, src, n * sizeof(Thread));
+    free(tmp);
+    return 1;
+}
+
+// Give every thread the index of its PID in first-seen order and return the
+// number of processes, or -1 if out of memory. An open-addressing PID table
+// keeps this linear for traces with many processes.
+static inline int index_processes(Thread threads[], int n) {
+    int capacity = 16;
+    while (capacity < 2 * n) capacity *= 2;
+    
+    int *slot_pid = malloc(capacity * sizeof(int));
+    int *slot_idx = malloc(capacity * sizeof(int));
+    int num_processes = 0;
+    
+    if (!slot_pid || !slot_idx) {
+        free(slot_pid);
+        free(slot_idx);
+        return -1;
+    }
+    for (int i = 0; i < capacity; i++) slot_idx[i] = -1;
+    
+    for (int i = 0; i < n; i++) {
+        unsigned int h = ((unsigned int)threads[i].pid * 2654435761u) & (capacity - 1);
+        while (slot_idx[h] != -1 && slot_pid[h] != threads[i].pid) {
+            h = (h + 1) & (capacity - 1);
+        }
+        if (slot_idx[h] == -1) {
+            slot_pid[h] = threads[i].pid;
+            slot_idx[h] = num_processes++;
+        }
+        threads[i].proc_idx = slot_idx[h];
+    }
+    
+    free(slot_pid);
+    free(slot_idx);
+    return num_processes;
+}
+
+static inline int load_latency_dist(const char *path, LatencyDist *dist) {
+    FILE *fp = fopen(path, "r");
+    char line[MAX_LINE];
+    long long total = 0;
+    
+    if (!fp) {
+        fprintf(stderr, "Error opening %s\n", path);
+        return 0;
+    }
+    
+    // Skip "Latency,Count" header
+    if (fgets(line, MAX_LINE, fp) == NULL) {
+        fclose(fp);
+        return 0;
+    }
+    
+    dist->num_bins = 0;
+    while (fgets(line, MAX_LINE, fp) != NULL && dist->num_bins < MAX_LATENCY_BINS) {
+        int latency, count;
+        if (sscanf(line, "%d,%d", &latency, &count) == 2 && latency >= 0 && count > 0) {
+            total += count;
+            dist->latency[dist->num_bins] = latency;
+            dist->cumulative[dist->num_bins] = total;
+            dist->num_bins++;
+        }
+    }
+    fclose(fp);
+    
+    if (dist->num_bins == 0) {
+        fprintf(stderr, "No latency samples in %s\n", path);
+        return 0;
+    }
+    return 1;
+}
+
+// splitmix64
+static inline unsigned long long next_random(unsigned long long *state) {
+    unsigned long long z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Fixed LATENCY, or a fresh draw from the measured distribution
+static inline int dispatch_latency(const LatencyDist *dist, unsigned long long *rng) {
+    if (dist == NULL) return LATENCY;
+    
+    long long r = (long long)(next_random(rng) % (unsigned long long)dist->cumulative[dist->num_bins - 1]);
+    int lo = 0, hi = dist->num_bins - 1;
+    while (lo < hi) {
+        int mid = (lo + hi) / 2;
+        if (dist->cumulative[mid] > r) hi = mid;
+        else lo = mid + 1;
+    }
+    return dist->latency[lo];
+}
+
+#endif